@@ -0,0 +1,79 @@
+# ============================================================================
+# harness.tcl - headless run of viott in openMSX, see run_harness.sh
+# Expects ::viott_map (linker map) and ::viott_out (result file) to be set
+# with -command before this script is loaded.
+#
+# viott signals "results ready" by a write to port 0x2F (signalDone() in
+# vdptest.c). The results are then read by symbol and written as lines of:
+#   <key> <value>
+# VOITT © 2025 by Pål Frogner Hansen is licensed under CC BY 4.0
+
+set renderer none
+set throttle off
+set save_settings_on_exit off
+
+set FREQS {NTSC PAL}
+
+proc peek_s32 {addr {debuggable "memory"}} {
+    binary scan [debug read_block $debuggable $addr 4] i result
+    return $result
+}
+
+proc peek_fix8 {addr {debuggable "memory"}} {
+    return [expr {[peek_s32 $addr $debuggable] / 256.0}]
+}
+
+# Global symbols from the sdld map file: "     0000C1A2  _g_axFinalTestCost   vdptest"
+proc read_symbols {mapfile} {
+    set symbols [dict create]
+    set f [open $mapfile r]
+    while {[gets $f line] >= 0} {
+        if {[regexp {^\s+([0-9A-Fa-f]{4,8})\s+_(\w+)} $line -> addr name]} {
+            dict set symbols $name [expr {"0x$addr" & 0xFFFF}]
+        }
+    }
+    close $f
+    return $symbols
+}
+
+proc symbol {name} {
+    if {![dict exists $::symbols $name]} {
+        error "symbol _$name not found in $::viott_map"
+    }
+    return [dict get $::symbols $name]
+}
+
+proc viott_done {} {
+    set out [open $::viott_out w]
+    set tests [peek [symbol g_uTestCount]]
+
+    for {set f 0} {$f < 2} {incr f} {
+        set freq [lindex $::FREQS $f]
+        puts $out [format "frame_cycles_%s %.2f" $freq [peek_fix8 [expr {[symbol g_axFrmTotalCycles] + 4 * $f}]]]
+
+        for {set t 0} {$t < $tests} {incr t} {
+            set addr [expr {[symbol g_axFinalTestCost] + 4 * ($f * $tests + $t)}]
+            puts $out [format "cost_%s_%02d %.2f" $freq $t [peek_fix8 $addr]]
+        }
+    }
+
+    # only the tests with a long test have a value, the rest are 0
+    for {set t 0} {$t < $tests} {incr t} {
+        puts $out [format "long_%02d %.2f" $t [peek_fix8 [expr {[symbol g_axLongTestCost] + 4 * $t}]]]
+    }
+
+    close $out
+    exit
+}
+
+set ::symbols [read_symbols $::viott_map]
+
+debug set_watchpoint write_io 0x2F {} viott_done
+
+# emulated time. A full run is well below this, also with the opcode sweep off
+after time 600 {
+    set out [open $::viott_out w]
+    puts $out "TIMEOUT"
+    close $out
+    exit
+}
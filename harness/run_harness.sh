@@ -0,0 +1,88 @@
+#!/bin/sh
+# ============================================================================
+# run_harness.sh - run viott headless in openMSX on a list of machines, for
+# the DOS and the ROM build, and compare the results with the stored ones.
+#
+# Usage: harness/run_harness.sh [-r] [machine ...]
+#   -r      record: store the results as the expected values
+#
+# Environment:
+#   OPENMSX         openMSX binary (default: openmsx)
+#   BUILDS          builds to run (default: "dos rom")
+#   TOL_COST        max deviation of a cost, in cycles (default: 0.02)
+#   TOL_FRAME       max deviation of frame cycles (default: 2)
+#
+# The DOS build needs MSX-DOS 2 in dska/ (see run.bat), and both builds need
+# their map file (objs/viott.map, objs/rom/viott.map).
+# VOITT © 2025 by Pål Frogner Hansen is licensed under CC BY 4.0
+
+cd "$(dirname "$0")/.." || exit 2
+
+OPENMSX=${OPENMSX:-openmsx}
+BUILDS=${BUILDS:-"dos rom"}
+TOL_COST=${TOL_COST:-0.02}
+TOL_FRAME=${TOL_FRAME:-2}
+RECORD=0
+
+if [ "$1" = "-r" ]; then
+    RECORD=1
+    shift
+fi
+
+MACHINES=${*:-"Panasonic_FS-A1WSX Philips_NMS_8255 Sony_HB-F1XD Panasonic_FS-A1ST"}
+
+mkdir -p harness/out harness/expected
+
+FAILED=0
+
+for MACHINE in $MACHINES; do
+    for BUILD in $BUILDS; do
+        NAME="${MACHINE}_${BUILD}"
+        OUT="harness/out/$NAME.txt"
+        EXPECTED="harness/expected/$NAME.txt"
+
+        if [ "$BUILD" = "rom" ]; then
+            MAP=objs/rom/viott.map
+            MEDIA="-cart rom/viott.rom -romtype ASCII16"
+        else
+            MAP=objs/viott.map
+            MEDIA="-ext ram1MB -ext msxdos2 -diska dska/"
+        fi
+
+        rm -f "$OUT"
+        # shellcheck disable=SC2086
+        "$OPENMSX" -machine "$MACHINE" $MEDIA \
+            -command "set ::viott_map $PWD/$MAP; set ::viott_out $PWD/$OUT" \
+            -script harness/harness.tcl > /dev/null 2>&1
+
+        if [ ! -s "$OUT" ] || grep -q TIMEOUT "$OUT"; then
+            echo "FAIL $NAME: no results (timeout or openMSX error)"
+            FAILED=1
+            continue
+        fi
+
+        if [ $RECORD -eq 1 ] || [ ! -f "$EXPECTED" ]; then
+            cp "$OUT" "$EXPECTED"
+            echo "REC  $NAME"
+            continue
+        fi
+
+        if awk -v tc="$TOL_COST" -v tf="$TOL_FRAME" -v name="$NAME" '
+            NR == FNR { exp[$1] = $2; next }
+            {
+                if (!($1 in exp)) { printf "  %s: %s not expected\n", name, $1; bad = 1; next }
+                tol = ($1 ~ /^frame_cycles/) ? tf : tc
+                d = $2 - exp[$1]
+                if (d < 0) d = -d
+                if (d > tol) { printf "  %s: %s is %s, expected %s\n", name, $1, $2, exp[$1]; bad = 1 }
+            }
+            END { exit bad }' "$EXPECTED" "$OUT"; then
+            echo "OK   $NAME"
+        else
+            echo "FAIL $NAME"
+            FAILED=1
+        fi
+    done
+done
+
+exit $FAILED
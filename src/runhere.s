@@ -4,4 +4,6 @@
 ;
     ; .area _HEAP
     .area _DATA
+_g_auScratch::     ; harmless memory for tests that write, (ix-n) lands here too
+    .ds 256
 _runTestAsmInMem:: ; test code to be copied in here, in the heap (after ram variables)
@@ -253,6 +253,17 @@ _memAPI_enaSltPg2_NI_fromC::
 	call	enableSlotInPage2_NI
 	ret
 
+;----------------------------------------------------------
+; Select this mapper segment in page 2. All mappers listen
+; to the same port, whatever slot they are in
+; IN: 		A - segment
+; MODIFIES: -
+;
+; extern void memAPI_setMapperPg2_NI_fromC( unsigned char uSegment );
+_memAPI_setMapperPg2_NI_fromC::
+	out		(0xFE), a
+	ret
+
 ;----------------------------------------------------------
 ; Select this slot and subslot in page 0
 ; Store this value in g_uCurSlotidPage0 (ram in page 3) as well
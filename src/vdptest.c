@@ -40,6 +40,7 @@
 //      * l  = unsigned long  (u32)
 //      * d  = signed long    (s32)
 //      * f  = float
+//      * x  = fixed point 24.8 (fix8), 1/256 units
 //      * p  = pointer
 //      * o  = object (struct)
 //      * a  = array (single or multi-dim)
@@ -53,22 +54,94 @@
 // VOITT © 2025 by Pål Frogner Hansen is licensed under CC BY 4.0
 // ---------------------------------------------------------------------------
 
-#include <stdio.h>      // herein be sprintf 
+#include <stdarg.h>     // formatText, our sprintf
 #include <string.h>     // memcpy
 #include <stdbool.h>
 
 // Typedefs & defines --------------------------------------------------------
 //
-#define DEBUG_FORCE_R800_FULLSPEED_IF AVAILABLE 0 // Testing code for provoking various speeds. R800 mode does not work atm!
+#define DEBUG_FORCE_R800_FULLSPEED_IF_AVAILABLE 0 // Testing code for provoking various speeds
 #define DEBUG_FORCE_TURBO_IF_AVAILABLE 0
 #define DEBUG_INSERT_TURBO_MID_TEST 0
 
-#define NUM_ITERATIONS      4       // Can't see that many are needed
+#define USE_S1990_TIMER_IF_AVAILABLE 1  // turbo R: time with the S1990 system timer instead of VBLANK
+#define USE_LINE_INT_TIMEBASE 1         // extra run with line interrupts (R#19), many samples per frame
+#define LONGTEST_ALL_TESTS 0            // 1: long test on every test, 0: VDP tests only
+#define OPCODE_SWEEP 0                  // DOS only: measure every opcode of every table (takes minutes)
+#define VRAM_MATRIX 0                   // VDP tests per screen mode, sprites on/off and display on/off (60 Hz)
+#define VDP_CMD_BENCH 0                 // command engine throughput per bitmap mode, sprites on/off and display on/off
+#define CMD_CONTENTION 0                // VDP tests in SCREEN 5, idle and with the command engine busy (HMMV)
+#define LINE_PROFILE 0                  // VDP test cost per LINE_INT_STEP lines, display and blanking (60 Hz)
+#define V9958_WTE 0                     // V9958 only: VDP tests in SCREEN 5 with the wait function (R#25 WTE) off/on
+#define PORT_SWEEP 0                    // DOS only: in a,(n) and out (n),a on all 256 ports (the safe ones)
+#define MEMORY_ATLAS 0                  // ROM only: M1, read and write penalty in page 2 of every slot and mapper segment, reads in page 0 and 1
+#define BLOCK_BENCH 0                   // ldir, lddr, otir, inir and cpir: cost of the repeat and the final step (60 Hz)
+#define USE_IM2 0                       // custom ISRs through IM 2 and a vector table in RAM. Page 0 is left alone
+#define SELF_CALIBRATION 0              // measure the tail, the VDP I/O wait in the ISR and the frame count add-up (60 Hz)
+#define VERNIER 0                       // Z80: frame cycles to the cycle, sync tests with the startup delayed 1 cycle at a time
+#define JITTER 0                        // sync tests over hundreds of frames in a row at 60 Hz: histogram and autocorrelation
+#define CLOCK_CHECK 0                   // frame rate in both modes and the CPU clock, against the RTC (~12 s)
+
+#define NUM_ITERATIONS      4       // Can't see that many are needed. Fixed amount, for the timebases other than VBLANK
+#define MIN_ITERATIONS      3       // VBLANK timebase is adaptive: at least this many...
+#define MAX_ITERATIONS      16      // ...and at most this many. Max 16 (g_anStudentT95Sq)
+#define CI_MAX_PERMILLE     1       // ...until the 95% confidence interval of the cost is within +-0.1%
+#define OUTLIER_PERMILLE    5       // samples further away from the median than 0.5% are rejected
 #define TEST_SEG_OFFSET     2	    // Test segments starts here. Only used in ROM code
 #define CALIBRATION_TESTS   2	    // Num#. We use these for finding the overall available cycles in a frame
 #define SIZE_TAIL_BLOCK     7	    // bytes
-#define SIZE_LONGTEST_TAIL  7	    // bytes
-#define FRAME_COUNT_ADD_UP  0.333f  // a heuristic/assumption to get closer to the exact value
+#define LONG_FRAMES         50      // Num# of frames per long test
+#define LONG_FRAMES_R800    25      // R800 wraps g_uExtraRounds (u8) on 1 cycle instructions at 50
+#define FRAME_COUNT_ADD_UP  85      // 0.333 in fix8. A heuristic/assumption to get closer to the exact value
+#define TIMER_FRAMES        8       // Num# of frames timed by the S1990 timer, to find frame cycles
+#define LINE_INT_FIRST      8       // First line interrupt, used for syncing only
+#define LINE_INT_STEP       8       // Lines between each line interrupt sample
+#define LINE_SAMPLES        25      // Samples per frame: line 16-208. Line interrupt can't go past 255
+#define PROFILE_SAMPLES     30      // Samples per frame in the line profile: line 16-248, into the blanking. >= LINE_SAMPLES
+#define SWEEP_DISP          0xF8    // (ix-8)/(iy-8) in the opcode sweep, lands in g_auScratch
+#define SWEEP_PORT          0x98    // n/C-port in the opcode sweep. VRAM is set up as in out98
+#define SWEEP_NOT_RUN       0xFFFF
+#define MATRIX_VARIANTS     4       // bit 0: sprites off (R#8 SPD), bit 1: display off (R#1 BL)
+#define MATRIX_MAX_TESTS    8       // VDP tests in the matrix, the rest are left out
+#define VDPCMD_NX           64      // size of each command engine command, in pixels. Max 256...
+#define VDPCMD_NY           64      // ...and max 128 (source and destination must not overlap)
+#define VDPCMD_FRAMES       16      // frames per command engine measurement, 60 Hz
+#define ATLAS_READ_BLOCK    0x0100  // the code of the data read test, in page 0 RAM (custom ISR active)
+#define ATLAS_READ_SIZE     0x1F00
+#define ATLAS_WRITE_BLOCK   0x2000  // the code of the data write test, in page 0 RAM too
+#define ATLAS_WRITE_SIZE    0x2000
+#define ATLAS_ROM_FETCH_SEG (TEST_SEG_OFFSET+8) // "!inca": inc a unrolled, M1 only as nop. For our own slot
+#define ATLAS_MAPPER_SEG    1       // mapper segment the BIOS puts in page 2
+#define ATLAS_MAX_SLOTS     16
+#define ATLAS_PAGE_READ_SIZE 0x3F80 // page 0 and 1 reads: ld a,(hl) in page 2...
+#define ATLAS_PAGE_RUN      0xBF80  // ...and atlasPageRun right after it
+#define BLOCK_COUNT         64      // BC (B for otir/inir) of the long block instructions. The short ones have 1
+#define IM2_AREA_SIZE       0x302   // a page aligned table of 257 bytes and the JP after it, wherever the area lands
+#define ATLAS_NOT_RUN       0xFFFF
+#define CALIB_TAIL_BLOCK    96      // bytes. Self-calibration: short block, many tails per frame...
+#define CALIB_TAIL_BLOCK_R800 512   // ...but under 256 rounds per frame (g_uExtraRounds is u8): ~230 at 512 on R800
+#define CALIB_PAD_READS     16      // extra VDP reads in the padded ISR
+#define JITTER_FRAMES       480     // frames in a row per sync test, 8 s. One sample more, the first frame has the common start in it
+#define JITTER_BINS         12      // histogram, one sync instruction (in cycles) each over the shortest frame. The last one has the rest
+#define JITTER_BAR          32      // chars for all the frames in one bin
+#define JITTER_LAGS         8
+#define CLOCK_SECONDS       5       // RTC seconds per frequency. Max 10 (frames * loop rounds must fit in u32 on R800)
+#define CLOCK_RTC_PPM       20      // assumed tolerance of the RTC crystal (32768 Hz), in the error estimates
+
+#if USE_LINE_INT_TIMEBASE==0
+#undef LINE_PROFILE
+#define LINE_PROFILE        0       // run together with the line interrupt timebase
+#endif
+
+#ifdef ROM_OUTPUT_FILE
+#undef OPCODE_SWEEP
+#define OPCODE_SWEEP        0       // the sweep builds its tests in RAM at runtime, DOS only
+#undef PORT_SWEEP
+#define PORT_SWEEP          0       // as the opcode sweep
+#else
+#undef MEMORY_ATLAS
+#define MEMORY_ATLAS        0       // page 2 must be free of program code, and slots.s is ROM only
+#endif
 
 typedef signed char         s8;
 typedef unsigned char       u8;
@@ -77,16 +150,27 @@ typedef unsigned short      u16;
 typedef unsigned long       u32;
 typedef signed long         s32;
 typedef const void          (function)(void);
+typedef s32                 fix8;           // fixed point, 24.8. All analysis is done in these, no floats
+
+#define FIX_SHIFT           8
+#define toFix(n)            ((fix8)(n) << FIX_SHIFT)
+#define FIX_SAT             0xFFFFFFFF      // mulSat() overflow
 
 #define halt()				{__asm halt __endasm;}
 #define enableInterrupt()	{__asm ei __endasm;}
 #define disableInterrupt()	{__asm di __endasm;}
 #define break()				{__asm in a,(0x2e) __endasm;} // for debugging. may be risky to use as it trashes A
+#define signalDone()		{__asm out (0x2f),a __endasm;} // results are ready, for harness/harness.tcl. Unused port
 #define arraysize(arr)      (sizeof(arr)/sizeof((arr)[0]))
+#define isR800(e)           ((e) >= R800_ROM)
 
 enum cpu_variant {Z80_PLAIN, Z80_TURBO, R800_ROM, R800_DRAM, NUM_CPU_VARIANTS};
 enum three_way {NO, YES, NA};
+enum atlas_access {ATLAS_FETCH, ATLAS_READ, ATLAS_WRITE, ATLAS_ACCESS_COUNT};
 enum freq_variant {NTSC, PAL, FREQ_COUNT};
+enum timebase {TIMEBASE_VBLANK, TIMEBASE_S1990};
+enum sweep_table {SWEEP_BASE, SWEEP_CB, SWEEP_ED, SWEEP_DD, SWEEP_FD, SWEEP_DDCB, SWEEP_FDCB, SWEEP_TABLE_COUNT};
+enum block_mem {BLOCK_RAM, BLOCK_ROM, BLOCK_VRAM, BLOCK_NONE};
 
 typedef struct {
     u8*                     szTestName;                 // max 9 characters
@@ -95,8 +179,11 @@ typedef struct {
 	u8                      uUnrollInstructionsSize;
 	u8                      uUnrollSingleInstructionSize;
     enum three_way          eReadVRAM;                  // if we should set up VRAM for write, read or nothing
+    bool                    bVDPPort;                   // on a VDP port (98h-9Bh), eReadVRAM or not. The VDP modes run these
     u8                      uStartupCycleCost;          // init of regs or so, at start of frame, before repeats
     u8                      uRealSingleCost;            // the cost of the unroll instruction(s) if run once
+    u8                      uStartupCycleCostR800;      // as uStartupCycleCost, but in R800 cycles
+    u8                      uRealSingleCostR800;        // as uRealSingleCost, but in R800 cycles (without any S1990 I/O wait)
     bool                    bForceRAMRun;
     u8                      uSegNum;                    // used only in ROM mode. 0xFF: not in use
 } TestDescriptor;
@@ -106,6 +193,20 @@ typedef struct {
     u8  uFrac;
 } IntWith2Decimals;
 
+typedef struct {
+    u8*                     szName;
+    u8                      uOpcode;                    // after the ED prefix
+    enum block_mem          eFrom;                      // VRAM is port 0x98, as in out98/in98
+    enum block_mem          eTo;
+} BlockTest;
+
+typedef struct {                                        // updated for every sample, see addSample()
+    u32                     lMin;
+    u32                     lMax;
+    u8                      uCount;
+    u8                      uXtraMax;                   // max of g_uExtraRounds
+} StreamStats;
+
 // Declarations (see .s-file) ------------------------------------------------
 //
 u8   getMSXType(void);
@@ -117,21 +218,41 @@ void enableTurbo(bool bEnable) __preserves_regs(e,h,l,iyl,iyh);
 bool isTurboEnabled(void) __preserves_regs(d,e,h,l,iyl,iyh);
 bool hasTurboFeature(void) __preserves_regs(d,e,h,l,iyl,iyh);
 
-void print(u8* szMessage);
+void printBIOS(u8* szMessage);
+void writeVRAMNI(u8 uLen, u8* pSrc);
+void readVRAMNI(u8 uLen, u8* pDst);
 bool getPALRefreshRate(void);
 void setPALRefreshRate(bool bPAL);
 void customISR(void);
+void customLineISR(void);
+void customLongISR(void);
+void customJitterISR(void);
+void customClockISR(void);
+void writeVDPRegNI(u8 uValue, u8 uReg);
 void setVRAMAddressNI(u8 uBitCodes, u16 nVRAMAddress);
 void initPalette(void);             // in case we mess up the palette during testing
 void restorePalette(void);
+void writePaletteNI(u8* pSrc);
 
 void runTestAsmInMem(void);
 
 void commonStartForAllTests(void);
-void longTest(void);
 
 u8   readClock(u8 uBlock0RegID);
 
+u16  runTimedS1990(u8* pEntry);
+u16  measureFramesS1990(u8 uFrames);
+
+void replicateUnroll(u8 uSize, u16 nBytes);
+u16  runVDPCommandNI(u8 uFrames, u8* pCmd);
+void startVDPCommandNI(const u8* pCmd);
+u8   getVDPID(void);
+void commonStartKeepIY(void);
+void setInterruptModeNI(u8 uTable);
+void runClockWindow(u8 uSeconds);
+void atlasPageRun(void);            // copied to ATLAS_PAGE_RUN, see runMemoryAtlas
+void atlasPageRunEnd(void);         // used for getting address only!
+
 // Consts / ROM friendly -----------------------------------------------------
 //
 const TestDescriptor    g_aoTest[] = {
@@ -142,8 +263,11 @@ const TestDescriptor    g_aoTest[] = {
                                             1,                  // u8               uUnrollInstructionsSize;
                                             1,                  // u8               uUnrollSingleInstructionSize;
                                             NA,                 // enum three_way   eReadVRAM;
+                                            false,              // bool             bVDPPort;
                                             11,                 // u8               uStartupCycleCost;
                                             5,                  // u8               uRealSingleCost;
+                                            3,                  // u8               uStartupCycleCostR800;
+                                            1,                  // u8               uRealSingleCostR800;
                                             true,               // bool             bForceRAMRun; - first run is ALWAYS in RAM
                                             0xFF                // u8               uSegNum;
                                         },
@@ -154,8 +278,11 @@ const TestDescriptor    g_aoTest[] = {
                                             1,                  // u8               uUnrollInstructionsSize;
                                             1,                  // u8               uUnrollSingleInstructionSize;
                                             NA,                 // enum three_way   eReadVRAM;
+                                            false,              // bool             bVDPPort;
                                             11,                 // u8               uStartupCycleCost;
                                             7,                  // u8               uRealSingleCost;
+                                            3,                  // u8               uStartupCycleCostR800;
+                                            1,                  // u8               uRealSingleCostR800;
                                             true,               // bool             bForceRAMRun; - second run is ALWAYS in RAM
                                             0xFF                // u8               uSegNum;
                                         },
@@ -166,8 +293,11 @@ const TestDescriptor    g_aoTest[] = {
                                             2,                  // u8               uUnrollInstructionsSize;
                                             2,                  // u8               uUnrollSingleInstructionSize;
                                             NO,                 // enum three_way   eReadVRAM;
+                                            true,               // bool             bVDPPort;
                                             11,                 // u8               uStartupCycleCost;
                                             12,                 // u8               uRealSingleCost;
+                                            3,                  // u8               uStartupCycleCostR800;
+                                            3,                  // u8               uRealSingleCostR800;
                                             false,              // bool             bForceRAMRun;
                                             TEST_SEG_OFFSET+0   // u8               uSegNum;
                                         },
@@ -178,24 +308,30 @@ const TestDescriptor    g_aoTest[] = {
                                             2,                  // u8               uUnrollInstructionsSize;
                                             2,                  // u8               uUnrollSingleInstructionSize;
                                             YES,                // enum three_way   eReadVRAM;
+                                            true,               // bool             bVDPPort;
                                             11,                 // u8               uStartupCycleCost;
                                             12,                 // u8               uRealSingleCost;
+                                            3,                  // u8               uStartupCycleCostR800;
+                                            3,                  // u8               uRealSingleCostR800;
                                             false,              // bool             bForceRAMRun;
                                             TEST_SEG_OFFSET+1   // u8               uSegNum;
                                         },
 
-                                        // {
-                                        //     "in98x",            // u8*              szTestName;
-                                        //     TEST_EMPTY,         // function*        pFncStartupBlock;
-                                        //     TEST_4_UNROLL,      // void             pFncUnrollInstruction;
-                                        //     2,                  // u8               uUnrollInstructionsSize;
-                                        //     2,                  // u8               uUnrollSingleInstructionSize;
-                                        //     NO,                 // enum three_way   eReadVRAM;
-                                        //     11,                 // u8               uStartupCycleCost;
-                                        //     12,                 // u8               uRealSingleCost;
-                                        //     false,              // bool             bForceRAMRun;
-                                        //     TEST_SEG_OFFSET+2   // u8               uSegNum;
-                                        // },
+                                        {
+                                            "in98x",            // u8*              szTestName;
+                                            TEST_EMPTY,         // function*        pFncStartupBlock;
+                                            TEST_4_UNROLL,      // void             pFncUnrollInstruction;
+                                            2,                  // u8               uUnrollInstructionsSize;
+                                            2,                  // u8               uUnrollSingleInstructionSize;
+                                            NO,                 // enum three_way   eReadVRAM;
+                                            true,               // bool             bVDPPort;
+                                            11,                 // u8               uStartupCycleCost;
+                                            12,                 // u8               uRealSingleCost;
+                                            3,                  // u8               uStartupCycleCostR800;
+                                            3,                  // u8               uRealSingleCostR800;
+                                            false,              // bool             bForceRAMRun;
+                                            TEST_SEG_OFFSET+10  // u8               uSegNum;
+                                        },
 
                                             {
                                                 "!inc(hl)",         // u8*              szTestName;
@@ -204,24 +340,30 @@ const TestDescriptor    g_aoTest[] = {
                                                 1,                  // u8               uUnrollInstructionsSize;
                                                 1,                  // u8               uUnrollSingleInstructionSize;
                                                 NA,                 // enum three_way   eReadVRAM;
+                                                false,              // bool             bVDPPort;
                                                 22,                 // u8               uStartupCycleCost;
                                                 12,                 // u8               uRealSingleCost;
+                                                6,                  // u8               uStartupCycleCostR800;
+                                                4,                  // u8               uRealSingleCostR800;
                                                 false,              // bool             bForceRAMRun;
                                                 TEST_SEG_OFFSET+2   // u8               uSegNum;
                                             },
 
-                                        // {
-                                        //     "in99",             // u8*              szTestName;
-                                        //     TEST_5_STARTUP,     // function*        pFncStartupBlock;
-                                        //     TEST_5_UNROLL,      // void             pFncUnrollInstruction;
-                                        //     2,                  // u8               uUnrollInstructionsSize;
-                                        //     2,                  // u8               uUnrollSingleInstructionSize;
-                                        //     NA,                 // enum three_way   eReadVRAM;
-                                        //     51,                 // u8               uStartupCycleCost;
-                                        //     12,                 // u8               uRealSingleCost;
-                                        //     false,              // bool             bForceRAMRun;
-                                        //     TEST_SEG_OFFSET+3   // u8               uSegNum;
-                                        // },
+                                        {
+                                            "in99",             // u8*              szTestName;
+                                            TEST_5_STARTUP,     // function*        pFncStartupBlock;
+                                            TEST_5_UNROLL,      // void             pFncUnrollInstruction;
+                                            2,                  // u8               uUnrollInstructionsSize;
+                                            2,                  // u8               uUnrollSingleInstructionSize;
+                                            NA,                 // enum three_way   eReadVRAM;
+                                            true,               // bool             bVDPPort;
+                                            51,                 // u8               uStartupCycleCost;
+                                            12,                 // u8               uRealSingleCost;
+                                            13,                 // u8               uStartupCycleCostR800;
+                                            3,                  // u8               uRealSingleCostR800;
+                                            false,              // bool             bForceRAMRun;
+                                            TEST_SEG_OFFSET+11  // u8               uSegNum;
+                                        },
 
                                             {
                                                 "!adca,iy0",        // u8*              szTestName;
@@ -230,25 +372,31 @@ const TestDescriptor    g_aoTest[] = {
                                                 3,                  // u8               uUnrollInstructionsSize;
                                                 3,                  // u8               uUnrollSingleInstructionSize;
                                                 NA,                 // enum three_way   eReadVRAM;
+                                                false,              // bool             bVDPPort;
                                                 11,                 // u8               uStartupCycleCost;
                                                 21,                 // u8               uRealSingleCost;
+                                                3,                  // u8               uStartupCycleCostR800;
+                                                5,                  // u8               uRealSingleCostR800;
                                                 false,              // bool             bForceRAMRun;
                                                 TEST_SEG_OFFSET+3   // u8               uSegNum;
                                             },
 
 
-                                        // {   // Palette test, must init first and restore palette after
-                                        //     "out9A",            // u8*              szTestName;
-                                        //     TEST_EMPTY,         // function*        pFncStartupBlock;
-                                        //     TEST_6_UNROLL,      // void             pFncUnrollInstruction;
-                                        //     2,                  // u8               uUnrollInstructionsSize;
-                                        //     2,                  // u8               uUnrollSingleInstructionSize;
-                                        //     NA,                 // enum three_way   eReadVRAM;
-                                        //     11,                 // u8               uStartupCycleCost;
-                                        //     12,                 // u8               uRealSingleCost;
-                                        //     false,              // bool             bForceRAMRun;
-                                        //     TEST_SEG_OFFSET+4   // u8               uSegNum;
-                                        // },
+                                        {   // Palette test, the palette is restored after (restoreVDPAfterTest)
+                                            "out9A",            // u8*              szTestName;
+                                            TEST_EMPTY,         // function*        pFncStartupBlock;
+                                            TEST_6_UNROLL,      // void             pFncUnrollInstruction;
+                                            2,                  // u8               uUnrollInstructionsSize;
+                                            2,                  // u8               uUnrollSingleInstructionSize;
+                                            NA,                 // enum three_way   eReadVRAM;
+                                            true,               // bool             bVDPPort;
+                                            11,                 // u8               uStartupCycleCost;
+                                            12,                 // u8               uRealSingleCost;
+                                            3,                  // u8               uStartupCycleCostR800;
+                                            3,                  // u8               uRealSingleCostR800;
+                                            false,              // bool             bForceRAMRun;
+                                            TEST_SEG_OFFSET+12  // u8               uSegNum;
+                                        },
 
                                         {
                                             "!bit0,iy0",        // u8*              szTestName;
@@ -257,24 +405,30 @@ const TestDescriptor    g_aoTest[] = {
                                             4,                  // u8               uUnrollInstructionsSize;
                                             4,                  // u8               uUnrollSingleInstructionSize;
                                             NA,                 // enum three_way   eReadVRAM;
+                                            false,              // bool             bVDPPort;
                                             11,                 // u8               uStartupCycleCost;
                                             22,                 // u8               uRealSingleCost;
+                                            3,                  // u8               uStartupCycleCostR800;
+                                            5,                  // u8               uRealSingleCostR800;
                                             false,              // bool             bForceRAMRun;
                                             TEST_SEG_OFFSET+4   // u8               uSegNum;
                                         },
 
-                                        // {   // Stream port test
-                                        //     "out9B",            // u8*              szTestName;
-                                        //     TEST_7_STARTUP,     // function*        pFncStartupBlock;
-                                        //     TEST_7_UNROLL,      // void             pFncUnrollInstruction;
-                                        //     2,                  // u8               uUnrollInstructionsSize;
-                                        //     2,                  // u8               uUnrollSingleInstructionSize;
-                                        //     NA,                 // enum three_way   eReadVRAM;
-                                        //     51,                 // u8               uStartupCycleCost;
-                                        //     12,                 // u8               uRealSingleCost;
-                                        //     false,              // bool             bForceRAMRun;
-                                        //     TEST_SEG_OFFSET+5   // u8               uSegNum;
-                                        // },
+                                        {   // Stream port test, on R#32 (SX low, only used by commands). R#17 is restored after
+                                            "out9B",            // u8*              szTestName;
+                                            TEST_7_STARTUP,     // function*        pFncStartupBlock;
+                                            TEST_7_UNROLL,      // void             pFncUnrollInstruction;
+                                            2,                  // u8               uUnrollInstructionsSize;
+                                            2,                  // u8               uUnrollSingleInstructionSize;
+                                            NA,                 // enum three_way   eReadVRAM;
+                                            true,               // bool             bVDPPort;
+                                            51,                 // u8               uStartupCycleCost;
+                                            12,                 // u8               uRealSingleCost;
+                                            13,                 // u8               uStartupCycleCostR800;
+                                            3,                  // u8               uRealSingleCostR800;
+                                            false,              // bool             bForceRAMRun;
+                                            TEST_SEG_OFFSET+13  // u8               uSegNum;
+                                        },
 
                                         {
                                             "!cpn",             // u8*              szTestName;
@@ -283,8 +437,11 @@ const TestDescriptor    g_aoTest[] = {
                                             2,                  // u8               uUnrollInstructionsSize;
                                             2,                  // u8               uUnrollSingleInstructionSize;
                                             NA,                 // enum three_way   eReadVRAM;
+                                            false,              // bool             bVDPPort;
                                             11,                 // u8               uStartupCycleCost;
                                             8,                  // u8               uRealSingleCost;
+                                            3,                  // u8               uStartupCycleCostR800;
+                                            2,                  // u8               uRealSingleCostR800;
                                             false,              // bool             bForceRAMRun;
                                             TEST_SEG_OFFSET+5   // u8               uSegNum;
                                         },
@@ -296,8 +453,11 @@ const TestDescriptor    g_aoTest[] = {
                                             2,                  // u8               uUnrollInstructionsSize;
                                             2,                  // u8               uUnrollSingleInstructionSize;
                                             NO,                 // enum three_way   eReadVRAM;
+                                            true,               // bool             bVDPPort;
                                             30,                 // u8               uStartupCycleCost;
                                             18,                 // u8               uRealSingleCost;
+                                            8,                  // u8               uStartupCycleCostR800;
+                                            4,                  // u8               uRealSingleCostR800;
                                             false,              // bool             bForceRAMRun;
                                             TEST_SEG_OFFSET+6   // u8               uSegNum;
                                         },
@@ -308,8 +468,11 @@ const TestDescriptor    g_aoTest[] = {
                                             2,                  // u8               uUnrollInstructionsSize;
                                             2,                  // u8               uUnrollSingleInstructionSize;
                                             NO,                 // enum three_way   eReadVRAM;
+                                            true,               // bool             bVDPPort;
                                             30,                 // u8               uStartupCycleCost;
                                             18,                 // u8               uRealSingleCost;
+                                            8,                  // u8               uStartupCycleCostR800;
+                                            4,                  // u8               uRealSingleCostR800;
                                             true,               // bool             bForceRAMRun;
                                             TEST_SEG_OFFSET+6   // u8               uSegNum;
                                         },
@@ -320,8 +483,11 @@ const TestDescriptor    g_aoTest[] = {
                                             2,                  // u8               uUnrollInstructionsSize;
                                             2,                  // u8               uUnrollSingleInstructionSize;
                                             NA,                 // enum three_way   eReadVRAM;
+                                            false,              // bool             bVDPPort;
                                             11,                 // u8               uStartupCycleCost;
                                             12,                 // u8               uRealSingleCost;
+                                            3,                  // u8               uStartupCycleCostR800;
+                                            3,                  // u8               uRealSingleCostR800;
                                             false,              // bool             bForceRAMRun;
                                             TEST_SEG_OFFSET+7   // u8               uSegNum;
                                         },
@@ -332,8 +498,11 @@ const TestDescriptor    g_aoTest[] = {
                                             2,                  // u8               uUnrollInstructionsSize;
                                             2,                  // u8               uUnrollSingleInstructionSize;
                                             NA,                 // enum three_way   eReadVRAM;
+                                            false,              // bool             bVDPPort;
                                             11,                 // u8               uStartupCycleCost;
                                             12,                 // u8               uRealSingleCost;
+                                            3,                  // u8               uStartupCycleCostR800;
+                                            3,                  // u8               uRealSingleCostR800;
                                             true,               // bool             bForceRAMRun;
                                             0xFF                // u8               uSegNum;
                                         },
@@ -344,8 +513,11 @@ const TestDescriptor    g_aoTest[] = {
                                             1,                  // u8               uUnrollInstructionsSize;
                                             1,                  // u8               uUnrollSingleInstructionSize;
                                             NA,                 // enum three_way   eReadVRAM;
+                                            false,              // bool             bVDPPort;
                                             11,                 // u8               uStartupCycleCost;
                                             5,                  // u8               uRealSingleCost;
+                                            3,                  // u8               uStartupCycleCostR800;
+                                            1,                  // u8               uRealSingleCostR800;
                                             false,              // bool             bForceRAMRun;
                                             TEST_SEG_OFFSET+8   // u8               uSegNum;
                                         },
@@ -356,8 +528,11 @@ const TestDescriptor    g_aoTest[] = {
                                             1,                  // u8               uUnrollInstructionsSize;
                                             1,                  // u8               uUnrollSingleInstructionSize;
                                             NA,                 // enum three_way   eReadVRAM;
+                                            false,              // bool             bVDPPort;
                                             11,                 // u8               uStartupCycleCost;
                                             5,                  // u8               uRealSingleCost;
+                                            3,                  // u8               uStartupCycleCostR800;
+                                            1,                  // u8               uRealSingleCostR800;
                                             true,               // bool             bForceRAMRun;
                                             0xFF                // u8               uSegNum;
                                         },
@@ -368,8 +543,11 @@ const TestDescriptor    g_aoTest[] = {
                                             2,                  // u8               uUnrollInstructionsSize;
                                             2,                  // u8               uUnrollSingleInstructionSize;
                                             NA,                 // enum three_way   eReadVRAM;
+                                            false,              // bool             bVDPPort;
                                             32,                 // u8               uStartupCycleCost;
                                             18,                 // u8               uRealSingleCost;
+                                            8,                  // u8               uStartupCycleCostR800;
+                                            4,                  // u8               uRealSingleCostR800;
                                             false,              // bool             bForceRAMRun;
                                             TEST_SEG_OFFSET+9   // u8               uSegNum;
                                         },
@@ -380,46 +558,73 @@ const TestDescriptor    g_aoTest[] = {
                                             2,                  // u8               uUnrollInstructionsSize;
                                             2,                  // u8               uUnrollSingleInstructionSize;
                                             NA,                 // enum three_way   eReadVRAM;
+                                            false,              // bool             bVDPPort;
                                             32,                 // u8               uStartupCycleCost;
                                             18,                 // u8               uRealSingleCost;
+                                            8,                  // u8               uStartupCycleCostR800;
+                                            4,                  // u8               uRealSingleCostR800;
                                             true,               // bool             bForceRAMRun;
                                             0xFF                // u8               uSegNum;
                                         }
                                      };
 
+const u8                g_uTestCount        = arraysize(g_aoTest); // for harness/harness.tcl
+
 const u8* const         g_aszCPUModes[]      = {"z80 @ 3.5MHz","z80 @ 5.7MHz (turbo)", "r800 @ 7.2MHz (comp)", "r800 @ 7.2MHz (DRAM)"};
 
 
 const u8                g_szErrorMSX[]      = "MSX2 and above is required";
-const u8                g_szGreeting[]      = "VDP I/O Timing Test v1.40 - %d repeats, %s, CPU: %s\r\n"; 
-const u8                g_szWait[]          = "...please wait 30 seconds or so...";
+const u8                g_szGreeting[]      = "VDP I/O Timing Test v1.50 - %d-%d repeats, %s, CPU: %s\r\n"; 
+const u8                g_szWait[]          = "...please wait a minute or two...";
 const u8                g_szRemoveWait[]    = "\r                                  \r";
 const u8                g_szReportCols[]    = "               avg   min   max  cost  ~d |      avg   min   max  cost  ~d\r\n";
 const u8                g_szReportValues[]  = "%9s %5ld.%02d %5ld %5ld %2ld.%02d %+3d | %5ld.%02d %5ld %5ld %2ld.%02d %+3d\r\n";
+const u8                g_szReportColsR800[]= "               avg    min    max  cost  ~d |   avg    min    max  cost  ~d\r\n";
+const u8                g_szReportValsR800[]= "%9s %6ld %6ld %6ld %2ld.%02d %+3d |%6ld %6ld %6ld %2ld.%02d %+3d\r\n"; // R800 counts pass 99999
 
 const u8                g_szSpeedHdrCols[]  = "          ---------- 60 Hz NTSC ---------|----------- 50 Hz PAL ---------\r\n";
 const u8                g_szSplitline[]     = "                                         |\r\n";
 const u8                g_szSpeedResult[]   = "Framecycles: %27s | %30s\r\n";
 const u8                g_szSRPart[]        = "%lu vs %lu, d:%+ld";
 
-const u8                g_szLongTest[]      = " longtest  %s\r\n";
-const u8                g_szLongInfo[]      = "VDP I/O added wait: %+d cycle(s)";
-const u8                g_szLongRTCError[]  = "(no result as internal clock is not working)";
+const u8                g_szLongHdr[]       = " longtest, %d frames per test at 60 Hz:\r\n";
+const u8                g_szLongVals[]      = "%9s cost: %ld.%02d, added wait: %c%ld.%02d cycle(s)\r\n";
+const u8                g_szTimebaseS1990[] = "Timebase: S1990 system timer (3.911us ticks)\r\n";
+const u8                g_szLineHdr[]       = "Line interrupts every %d lines, %d samples per test, counts are per sample\r\n";
+const u8                g_szLineCPL[]       = "Cycles/line: %ld.%02d (60 Hz) | %ld.%02d (50 Hz)\r\n";
+const u8                g_szReportColsS1990[]="              full   half  cost  ~d |   full   half  cost  ~d\r\n";
+const u8                g_szReportValsS1990[]="%9s %6ld %6ld %2ld.%02d %+3d |%6ld %6ld %2ld.%02d %+3d\r\n"; // timer ticks
 const u8                g_szSummary[]       = "[EVALUATE] We have an issue if ~d is greater than 0 on any of the lines\r\n";
+const u8                g_szR800WaitHdr[]   = "S1990 VDP I/O wait in R800 cycles:\r\n";
+const u8                g_szR800WaitVals[]  = "%9s %c%ld.%02d (60 Hz) %c%ld.%02d (50 Hz)\r\n";
+
+const u8                g_szRobustHdr[]     = "Per test: iterations, median, std.dev, rejected outliers:\r\n";
+const u8                g_szRobustVals[]    = "%9s %2d %6ld %4ld.%02d %2d          | %2d %6ld %4ld.%02d %2d\r\n";
 
 const u8                g_szNewline[]       = "\r\n";
 
+// Where the BIOS keeps its copy of the palette in VRAM, per SCREEN. SCREEN 0 in width 80 has it at 0x0F00
+const u16               g_anPaletteTable[]  = {0x0400, 0x2020, 0x1B80, 0x2020, 0x1E80, 0x7680, 0x7680, 0xFA80, 0xFA80};
+
 const u8* const         g_aszFreq[]         = {"60", "50"}; // must be chars
 
 // Normal. Turbo is supposedly 50% faster.
 // PAL (“50 FPS”):  71364 cycles (3579545/50.159), turbo (+50%): 107046 cycles, measured: 106776 (49.62%)
 // NTSC (“60 FPS”): 59736 cycles (3579545/59.923), turbo (+50%):  89604 cycles, measured:  89387 (49.64%)
-// 
-const u32 alFRAME_CYCLES_TARGET[NUM_CPU_VARIANTS][FREQ_COUNT] = {{59736, 71364}, {89387, 106776}, {150000, 200000}, {200000, 300000}}; // assumed "ideal"
+// R800 runs at 7159090 Hz (28.63636 MHz/4) in both ROM and DRAM mode. The modes differ in where the
+// BIOS is fetched from, not in clock, so the frame holds the same amount of cycles:
+// PAL:  142727 cycles (7159090/50.159)
+// NTSC: 119471 cycles (7159090/59.923)
+//
+const u32 alFRAME_CYCLES_TARGET[NUM_CPU_VARIANTS][FREQ_COUNT] = {{59736, 71364}, {89387, 106776}, {119471, 142727}, {119471, 142727}}; // assumed "ideal"
 
-const u8                FRAME_CYCLES_INT                    = 171;
+const u8                FRAME_CYCLES_INT                    = 171; // _customISR when not storing the PC-reg, as in all frames but the last
 const u8                FRAME_CYCLES_INT_TURBO_ADD          = 3 * (32) + 7;
+#if USE_IM2==1
+const u8                FRAME_CYCLES_INT_KICK_OFF           = 20 + 11; // 19+1 with the vector read, +11 is the JP in the IM 2 stub
+#else
 const u8                FRAME_CYCLES_INT_KICK_OFF           = 14 + 11; // +11 is the JP at 0x0038
+#endif
 const u8                FRAME_CYCLES_INT_KICK_OFF_TURBO_ADD = 0 + 2;
 const u8                FRAME_CYCLES_COMMON_START           = 72; // cycles after halt
 const u8                FRAME_CYCLES_COMMON_START_TURBO_ADD = 8;
@@ -427,12 +632,241 @@ const u8                FRAME_CYCLES_COMMON_START_TURBO_ADD = 8;
 const u8                FRAME_CYCLES_TAIL_Z80               = 42;
 const u8                FRAME_CYCLES_TAIL_Z80_TURBO_ADD     = 3; // maybe more, how do I know??? 
 
+// R800 counterparts, in R800 cycles. Counted from the R800 timing tables (https://map.grauw.nl/resources/z80instr.php)
+// The S1990 adds I/O wait on every VDP access, also the three done in _customISR, this is NOT included here
+const u8                FRAME_CYCLES_INT_R800               = 46; // the path not storing the PC-reg, as FRAME_CYCLES_INT
+#if USE_IM2==1
+const u8                FRAME_CYCLES_INT_KICK_OFF_R800      = 8 + 2 + 3; // +2 the vector read (from the R800 memory timing), +3 the JP
+#else
+const u8                FRAME_CYCLES_INT_KICK_OFF_R800      = 8 + 3; // +3 is the JP at 0x0038
+#endif
+const u8                FRAME_CYCLES_COMMON_START_R800      = 19; // cycles after halt
+const u8                FRAME_CYCLES_TAIL_R800              = 10;
+
+// _customLineISR, including the kick-off. Turbo adds ~32 per VDP I/O (7 of them), just as for FRAME_CYCLES_INT_TURBO_ADD
+#if USE_IM2==1
+const u16               FRAME_CYCLES_LINE_INT               = 568 + 31;
+#else
+const u16               FRAME_CYCLES_LINE_INT               = 568 + 25;
+#endif
+const u16               FRAME_CYCLES_LINE_INT_TURBO_ADD     = 7 * (32) + 7;
+#if USE_IM2==1
+const u16               FRAME_CYCLES_LINE_INT_R800          = 141 + 13; // S1990 I/O wait not included
+#else
+const u16               FRAME_CYCLES_LINE_INT_R800          = 141 + 11; // S1990 I/O wait not included
+#endif
+
+#if SELF_CALIBRATION==1
+// in a,(n), without any I/O wait. The self-calibration measures what is added on the VDP ports, and
+// puts that in for the three VDP I/O in _customISR, instead of the 3 * (32) in FRAME_CYCLES_INT_TURBO_ADD
+const u8                CALIB_IN_CYCLES                     = 12;
+const u8                CALIB_IN_CYCLES_R800                = 3;
+const u8                CALIB_ISR_VDP_IO                    = 3;
+#endif
+
+#if CLOCK_CHECK==1
+// _runClockWindow and _customClockISR, in Z80 cycles. The clocks we expect, turbo as "+50%"
+const u8                CLOCK_LOOP_CYCLES                   = 61;
+const u8                CLOCK_WRAP_CYCLES                   = 16;   // every 65536 rounds
+const u8                CLOCK_EDGE_CYCLES                   = 28;   // every change of the seconds digit, but the last
+const u8                CLOCK_ISR_CYCLES                    = 221;  // + FRAME_CYCLES_INT_KICK_OFF
+const u32               alCLOCK_NOMINAL[NUM_CPU_VARIANTS]   = {3579545, 5369317, 7159090, 7159090};
+#endif
+
+// The S1990 timer ticks at 28.63636 MHz/112. That is exactly 14 Z80 cycles (3.58MHz) and 28 R800
+// cycles. The Z80_TURBO entry is for completeness only, as no machine with turbo has the S1990.
+const u8 auS1990_CYCLES_PER_TICK[NUM_CPU_VARIANTS] = {14, 21, 28, 28};
+
+// Student's t, 95% two-sided, squared and x100, by degrees of freedom (index 0 not used)
+const u16 g_anStudentT95Sq[MAX_ITERATIONS] = {0, 16145, 1852, 1013, 771, 661, 599, 559, 532, 512, 496, 484, 475, 467, 460, 454};
+
+#if OPCODE_SWEEP==1
+// Opcode sweep. The sets are bitmaps over the 256 opcodes of a table (bit n of byte n/8).
+// Excluded are the ones changing PC, SP or the interrupt state, exx (hl' is used by the tail),
+// and the prefixes (own tables). Prefix chains would also hold back the interrupt.
+const u8* const         g_aszSweepTable[]       = {"", "CB", "ED", "DD", "FD", "DDCB", "FDCB"};
+const u8                g_auSweepPrefix[]       = {0x00, 0xCB, 0xED, 0xDD, 0xFD, 0xDD, 0xFD};
+const u8                g_auSweepExclude[32]    = {0x00, 0x00, 0x01, 0x01, 0x01, 0x01, 0x0B, 0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00,
+                                                   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xBF, 0xBF, 0xB7, 0xB7, 0xBF, 0xB7, 0xBF, 0xBF};
+const u8                g_auSweepImmN[32]       = {0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                                   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x40, 0x48, 0x48, 0x40, 0x40, 0x40, 0x40};
+const u8                g_auSweepImmNN[32]      = {0x02, 0x00, 0x02, 0x00, 0x06, 0x04, 0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                                   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+const u8                g_auSweepMemHL[32]      = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x70, 0x00, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0xBF, 0x40,
+                                                   0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}; // (hl) -> (ix+d)
+const u8                g_auSweepWritesIX[32]   = {0x00, 0x02, 0x00, 0x02, 0x7A, 0x7E, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0xBF, 0xBF, 0x00, 0x00,
+                                                   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}; // DD only, jp (ix) in tail
+#if USE_IM2==1
+const u8                g_auSweepExcludeED[32]  = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, 0x61, 0x60, 0x60, 0x60, 0x60, 0x60, 0x68,
+                                                   0x00, 0x00, 0x00, 0x00, 0x05, 0x05, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}; // as below, and ld i,a: I points to the IM 2 table
+#else
+const u8                g_auSweepExcludeED[32]  = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x61, 0x60, 0x60, 0x60, 0x60, 0x60, 0x68,
+                                                   0x00, 0x00, 0x00, 0x00, 0x05, 0x05, 0x0F, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}; // retn, im, in c,(c) (the port), ld sp,(nn), ldi/ini/ldd/ind, repeats
+#endif
+const u8                g_auSweepImmNNED[32]    = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+                                                   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+const u8                g_szSweepHdr[]          = "Opcode sweep, prefix: %s, cycles per instruction (--: not run):\r\n";
+#endif
+
+#if PORT_SWEEP==1
+// Port sweep. Same bitmaps, over the 256 ports. Not read: VDP status (clears the VBLANK
+// flag before the interrupt is taken), FDC, RS-232 and MIDI (8251) and 0x2E (the openMSX
+// debug watchpoint). Not written, also: 0x2F (the harness's results-ready port), switched
+// I/O, printer strobe, VDP control and indirect, PSG and RTC data, slot select,
+// PPI, S1990, system control, AV control and the memory mapper. A is 0 on out
+const u8* const         g_aszPortDir[]          = {"in", "out"};
+const u8                g_auPortExcludeIn[32]   = {0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                                   0xFF, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x00, 0xFF, 0x00, 0x00};
+const u8                g_auPortExcludeOut[32]  = {0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                                   0xFF, 0x00, 0x01, 0x0A, 0x02, 0x0D, 0x20, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x30, 0xFF, 0xF8, 0xF0};
+const u8                g_szPortHdr[]           = "Port sweep, %s, cycles per instruction (--: not run):\r\n";
+#endif
+
+#if MEMORY_ATLAS==1
+const u8                g_szAtlasHdr[]          = "Memory atlas, page 2 (M1, read, write) and page 0 and 1 (read), cycles\r\nper instruction at 60 Hz. Internal RAM (*):\r\n";
+const u8                g_szAtlasBase[]         = "nop %d.%02d, ld a,(hl) %d.%02d, ld (hl),a %d.%02d. Added per access:\r\n";
+const u8                g_szAtlasCols[]         = "slot segs  M1 (nop)       ld a,(hl)      ld (hl),a       ld a,(hl)\r\n              min    max     min    max     min    max page 0 page 1\r\n";
+const u8                g_szAtlasSlot[]         = "%d  %c";
+const u8                g_szAtlasSlotExp[]      = "%d-%d%c";
+const u8                g_szAtlasSegs[]         = " %4d";
+const u8                g_szAtlasNoRAM[]        = "    -";
+const u8                g_szAtlasNum[]          = "%c%d.%02d";
+const u8                g_szAtlasCell[]         = " %6s";
+const u8                g_szAtlasNotRun[]       = "      --     --";
+#endif
+
+#if BLOCK_BENCH==1
+// ROM is page 1 in ROM mode (our own cartridge). In DOS mode there is RAM only
+const BlockTest         g_aoBlockTest[]         = {
+                                                    {"ldir", 0xB0, BLOCK_RAM,  BLOCK_RAM},
+                                                    {"lddr", 0xB8, BLOCK_RAM,  BLOCK_RAM},
+                                                    {"otir", 0xB3, BLOCK_RAM,  BLOCK_VRAM},
+                                                    {"inir", 0xB2, BLOCK_VRAM, BLOCK_RAM},
+                                                    {"cpir", 0xB1, BLOCK_RAM,  BLOCK_NONE},
+#ifdef ROM_OUTPUT_FILE
+                                                    {"ldir", 0xB0, BLOCK_ROM,  BLOCK_RAM},
+                                                    {"otir", 0xB3, BLOCK_ROM,  BLOCK_VRAM},
+#endif
+                                                  };
+const u8* const         g_aszBlockMem[]         = {"RAM", "ROM", "VRAM", "-"};
+const u8                g_szBlockHdr[]          = "Block instructions, BC 1 and %d, %d frames at 60 Hz (cycles):\r\n";
+const u8                g_szBlockCols[]         = "instr  from  to     setup  final repeat\r\n";
+const u8                g_szBlockRow[]          = "%-6s %-5s %-5s";
+const u8                g_szBlockNum[]          = "%c%ld.%02d";
+const u8                g_szBlockCell[]         = " %6s";
+#endif
+
+#if SELF_CALIBRATION==1
+const u8                g_szCalibHdr[]          = "Self-calibration at 60 Hz, cycles measured (assumed):\r\n";
+const u8                g_szCalibVals[]         = "Tail %ld.%02d (%d), VDP I/O wait %ld.%02d, frame overhead %d (%d)\r\n";
+const u8                g_szCalibAddUp[]        = "Frame count add-up, sync1, estimated from the sync overlap: %c%ld.%02d (%s Hz) %c%ld.%02d (%s Hz) (0.33)\r\n";
+#endif
+
+#if VERNIER==1
+const u8                g_szVernierHdr[]        = "Vernier, frame cycles in the unrolled blocks and tails (sync tests, startup delayed 1 cycle at a time):\r\n";
+const u8                g_szVernierVals[]       = "%s Hz: %ld-%ld, frame count add-up, sync1: %c%ld.%02d (0.33)\r\n";
+const u8                g_szVernierNone[]       = "%s Hz: no cycle in common\r\n";
+#endif
+
+#if JITTER==1
+const u8                g_szJitterHdr[]         = "Frame jitter at 60 Hz, %d frames in a row per sync test (cycles):\r\n";
+const u8                g_szJitterTest[]        = "%s: shortest %ld, spread %ld, mean +%ld.%02d, clipped %d\r\n";
+const u8                g_szJitterBin[]         = "%6ld%c %4d ";
+const u8                g_szJitterLags[]        = "Autocorrelation x100, lag 1-%d:";
+const u8                g_szJitterLag[]         = " %4ld";
+const u8                g_szJitterFlat[]        = " (no spread)";
+#endif
+
+#if CLOCK_CHECK==1
+const u8                g_szClockHdr[]          = "Clock check against the RTC, %d s per frequency (!: off the expected clock by more than 1/200):\r\n";
+const u8                g_szClockFreq[]         = "%s Hz: frame rate %ld.%03ld Hz +-0.%03ld, %d frames\r\n";
+const u8                g_szClockCPU[]          = "CPU from %s Hz frame cycles: %ld Hz +-%ld, x%ld.%04ld of 3579545 Hz %c\r\n";
+const u8                g_szClockLoop[]         = "CPU from the RTC loop: %ld Hz +-%ld, x%ld.%04ld of 3579545 Hz %c\r\n";
+const u8                g_szClockNone[]         = "%s Hz: no frames counted\r\n";
+#endif
+
+#if OPCODE_SWEEP==1 || PORT_SWEEP==1
+const u8                g_szSweepRow[]          = "%4s %02X:";
+const u8                g_szSweepCell[]         = " %2d.%02d";
+const u8                g_szSweepNotRun[]       = "    --";
+#endif
+
+#if VRAM_MATRIX==1
+const u8                g_auMatrixModes[]       = {0, 4, 5, 7, 8};  // text, pattern and bitmap modes. SCREEN 7 and 8 need 128kB VRAM
+const u8                g_szMatrixHdr[]         = "VRAM I/O matrix, cycles per instruction at 60 Hz (spr: sprites, dsp: display):\r\n";
+const u8                g_szMatrixCols[]        = "SCREEN %d   spr+ dsp+  spr- dsp+  spr+ dsp-  spr- dsp-\r\n";
+const u8                g_szMatrixName[]        = "%9s";
+const u8                g_szMatrixCell[]        = " %7ld.%02d";
+const u8                g_szMatrixNotRun[]      = "         --";
+#endif
+
+#if LINE_PROFILE==1
+const u8                g_szProfileHdr[]        = "Line profile at 60 Hz, cycles per instruction per %d lines from line %d. Display ends at line %d:\r\n";
+const u8                g_szProfileRow[]        = "%9s %3d:";
+const u8                g_szProfileCell[]       = " %3ld.%02d";
+#endif
+
+#if CMD_CONTENTION==1 || V9958_WTE==1
+// HMMV over all of the 128kB in SCREEN 5, 256x1023. Lasts a few frames, also with the display off
+const u8                g_auContentionCmd[15]   = {0, 0, 0, 0, 0, 0, 0, 0, 0x00, 0x01, 0xFF, 0x03, 0x44, 0, 0xC0};
+#endif
+
+#if CMD_CONTENTION==1
+const u8                g_szContentionHdr[]     = "Command engine busy (HMMV, SCREEN 5), cycles per instruction at 60 Hz:\r\n";
+const u8                g_szContentionCols[]    = "            idle    busy  added\r\n";
+const u8                g_szContentionVals[]    = "%9s %4ld.%02d %4ld.%02d %c%ld.%02d\r\n";
+#endif
+
+#if V9958_WTE==1
+const u8                g_szWaitHdr[]           = "V9958 wait function (R#25 WTE), SCREEN 5, cycles per instruction at 60 Hz:\r\n";
+const u8                g_szWaitCols[]          = "            idle    busy  idle+WTE busy+WTE\r\n";
+const u8                g_szWaitVals[]          = "%9s %4ld.%02d %4ld.%02d %5ld.%02d %5ld.%02d\r\n";
+const u8                g_szWaitNoV9958[]       = "V9958 wait function: not a V9958, skipped\r\n";
+#endif
+
+#if VDP_CMD_BENCH==1
+const u8                g_auCmdModes[]          = {5, 6, 7, 8};
+const u16               g_anCmdModeWidth[]      = {256, 512, 512, 256};
+const u8                g_auCmdModeBpp[]        = {4, 2, 4, 8};     // bits per pixel
+const u8* const         g_aszCmdNames[]         = {"HMMM", "LMMM", "YMMM", "HMMV", "LMMV"};
+const u8                g_auCmdCodes[]          = {0xD0, 0x90, 0xE0, 0xC0, 0x80};   // R#46, logical op IMP
+const u8                g_szCmdHdr[]            = "Command engine, %dx%d per command, pixels/bytes per frame at 60 Hz:\r\n";
+const u8                g_szCmdCols[]           = "SCREEN %d      spr+ dsp+     spr- dsp+     spr+ dsp-     spr- dsp-\r\n";
+const u8                g_szCmdName[]           = "%9s";
+const u8                g_szCmdCell[]           = " %6lu/%6lu";
+#endif
+
 
 // RAM variables -------------------------------------------------------------
 //
 enum cpu_variant        g_eCPUMode;
+enum timebase           g_eTimebase;
+#if USE_IM2==1
+u8                      g_auIM2Area[IM2_AREA_SIZE]; // see initIM2
+u8                      g_uIM2Table;        // I, high byte of the vector table
+void**                  g_ppInterruptIM2;   // the address in the JP of the IM 2 stub
+#define g_pInterrupt    (*g_ppInterruptIM2)
+#else
 void* __at(0x0039)      g_pInterrupt;       // We assume that 0x0038 already holds 0xC3 (JP) in dos mode at startup
+#endif
 void*                   g_pInterruptOrg;
+u8 __at(0xF3DF)         g_uBIOS_RG0SAV;     // mirror of VDP R#0
+u8 __at(0xF3E0)         g_uBIOS_RG1SAV;     // mirror of VDP R#1
+u8 __at(0xF3B0)         g_uBIOS_LINLEN;     // current text width
+u8 __at(0xF3B1)         g_uBIOS_CRTCNT;     // text rows
+u16 __at(0xF3B3)        g_nBIOS_TXTNAM;     // SCREEN 0 name table
+u8 __at(0xF3DC)         g_uBIOS_CSRY;       // cursor, 1-based
+u8 __at(0xF3DD)         g_uBIOS_CSRX;
+u8 __at(0xF3DE)         g_uBIOS_CNSDFG;     // function keys shown on the last row
+u8 __at(0xFCAF)         g_uBIOS_SCRMOD;
+u8 __at(0xFFE7)         g_uBIOS_RG8SAV;     // mirror of VDP R#8
+u8 __at(0xFAFC)         g_uBIOS_MODE;       // bit 1-2: VRAM size, 10 = 128kB
+u8 __at(0xFFE8)         g_uBIOS_RG9SAV;     // mirror of VDP R#9
+u8 __at(0xFFF0)         g_uBIOS_RG17SAV;    // mirror of VDP R#17
+u8 __at(0xFFFA)         g_uBIOS_RG25SAV;    // mirror of VDP R#25 (V9958)
+u8                      g_auPalette[32];    // as in the BIOS palette table in VRAM, see savePalette()
+u8                      g_auTextRow[80];    // scroll buffer, g_auBuffer may be the text being printed
 u8                      g_auBuffer[120];    // temp/general buffer here to avoid stack explosion
 
 volatile u8*            g_pPCReg;           // pointer to PC-reg when the interrupt was triggered
@@ -441,30 +875,132 @@ volatile u8             g_uExtraRounds;     // test is "too" fast, one full segm
 function*               g_pFncCurStartupBlock;
 
                         // RESULTS BELOW. As R800 can have instructions of 1 cycle only, we can get iterations with > u16 in PAL
-float                   g_afFrmTotalCycles      [FREQ_COUNT];
-float                   g_afFrmTotalCyclesNoTail[FREQ_COUNT];
-u32                     g_alFrameInstrResult    [FREQ_COUNT][arraysize(g_aoTest)][NUM_ITERATIONS];
-float                   g_afFrameInstrResultAvg [FREQ_COUNT][arraysize(g_aoTest)];
-u32                     g_alFrameInstrResultMin [FREQ_COUNT][arraysize(g_aoTest)];
-u32                     g_alFrameInstrResultMax [FREQ_COUNT][arraysize(g_aoTest)];
-u8                      g_auFrameInstrResultXtra[FREQ_COUNT][arraysize(g_aoTest)][NUM_ITERATIONS];
-u8                      g_auFrameInstrResultXtr2[FREQ_COUNT][arraysize(g_aoTest)];
-float                   g_afFinalTestCost       [FREQ_COUNT][arraysize(g_aoTest)];
-s16                     g_iVDPDiff;
-
-                        // Long test timings via RTC (start:0, end:1)
-bool                    g_bRTCWorking;
-u32                     g_lStartTimeStamp;
-u32                     g_lEndTimeStamp;
-u8                      g_uSecondsL0;
-u8                      g_uSecondsH0;
-u8                      g_uMinsL0;
-u8                      g_uMinsH0;
-
-u8                      g_uSecondsL1;
-u8                      g_uSecondsH1;
-u8                      g_uMinsL1;
-u8                      g_uMinsH1;
+fix8                    g_axFrmTotalCycles      [FREQ_COUNT];
+fix8                    g_axFrmTotalCyclesNoTail[FREQ_COUNT];
+StreamStats             g_aoFrameStats          [FREQ_COUNT][arraysize(g_aoTest)];
+u32                     g_alWindow              [MAX_ITERATIONS];   // samples of the running test only, sorted. For the median
+fix8                    g_axFrameInstrResultAvg [FREQ_COUNT][arraysize(g_aoTest)];
+u32                     g_alFrameInstrResultMed [FREQ_COUNT][arraysize(g_aoTest)];
+fix8                    g_axFrameInstrResultSD  [FREQ_COUNT][arraysize(g_aoTest)];
+u8                      g_auOutliers            [FREQ_COUNT][arraysize(g_aoTest)];
+fix8                    g_axFinalTestCost       [FREQ_COUNT][arraysize(g_aoTest)];
+
+                        // Long test. Instructions include the extra rounds
+volatile u8             g_uLongFramesLeft;
+u32                     g_alLongInstr           [arraysize(g_aoTest)];
+u8                      g_auLongXtra            [arraysize(g_aoTest)];
+fix8                    g_axLongTestCost        [arraysize(g_aoTest)];
+
+                        // Line interrupt timebase. Samples are written by customLineISR
+volatile u8             g_uLineIntNext;
+volatile u8             g_uLineIntStep;
+volatile u8             g_uLineSample;
+volatile u8             g_uLineSamples;
+volatile u16            g_anLinePC              [PROFILE_SAMPLES];
+volatile u8             g_auLineXtra            [PROFILE_SAMPLES];
+u32                     g_alLineInstrSum        [FREQ_COUNT][arraysize(g_aoTest)];
+u16                     g_anLineInstrMin        [FREQ_COUNT][arraysize(g_aoTest)];
+u16                     g_anLineInstrMax        [FREQ_COUNT][arraysize(g_aoTest)];
+u16                     g_anLineXtraSum         [FREQ_COUNT][arraysize(g_aoTest)];
+fix8                    g_axLineCyclesPerLine   [FREQ_COUNT];
+fix8                    g_axLineTestCost        [FREQ_COUNT][arraysize(g_aoTest)];
+
+                        // S1990 timebase: ticks summed over NUM_ITERATIONS, for a full and a half run through the block
+u32                     g_alTimerTicksFull      [FREQ_COUNT][arraysize(g_aoTest)];
+u32                     g_alTimerTicksHalf      [FREQ_COUNT][arraysize(g_aoTest)];
+u16                     g_anTimerFrameTicks     [FREQ_COUNT];
+
+#if OPCODE_SWEEP==1 || PORT_SWEEP==1
+extern u8               g_auScratch[];      // 256 bytes, just before runTestAsmInMem (runhere.s)
+u8                      g_auSweepStartup[15];
+u8                      g_auSweepInstr[4];
+#endif
+
+#if OPCODE_SWEEP==1
+u16                     g_anSweepCost           [SWEEP_TABLE_COUNT][256]; // 1/100 cycles, 60 Hz
+#endif
+
+#if PORT_SWEEP==1
+u16                     g_anPortCost            [2][256];   // in, out. 1/100 cycles, 60 Hz
+#endif
+
+#if BLOCK_BENCH==1
+u8                      g_auBlockBuf[2 * BLOCK_COUNT];  // from, to. Filled with 0xFF, cpir looks for 0
+u8                      g_auBlockPattern[12];
+fix8                    g_axBlockCost       [arraysize(g_aoBlockTest)][3];  // setup, final step, repeat step
+#endif
+
+#if MEMORY_ATLAS==1
+u8                      g_auAtlasStartup[8];
+u8                      g_auAtlasSave[256]; // byte 0 of every mapper segment, while finding the mapper size
+u8                      g_uAtlasSlots;
+u8                      g_auAtlasSlotID     [ATLAS_MAX_SLOTS];
+u16                     g_anAtlasSegments   [ATLAS_MAX_SLOTS];      // 0: no RAM in page 2
+u16                     g_anAtlasCost       [ATLAS_MAX_SLOTS][ATLAS_ACCESS_COUNT][2]; // min, max over the segments. 1/100 cycles, 60 Hz
+u16                     g_anAtlasBase       [ATLAS_ACCESS_COUNT];   // the same, internal RAM
+u16                     g_anAtlasPageRead   [ATLAS_MAX_SLOTS][2];   // ld a,(hl) in page 0 and 1. ATLAS_NOT_RUN: page 0 with IM 1
+u8                      g_auAtlasSwitch[4];                         // for atlasPageRun
+#endif
+
+#if SELF_CALIBRATION==1
+u8                      g_auPadISR[9 + 2 * CALIB_PAD_READS + 4];
+bool                    g_bSelfCalibrated;  // the measured values below are used instead of the assumed ones
+fix8                    g_xTailCycles;
+fix8                    g_xVDPIOWait;       // per VDP I/O, on top of CALIB_IN_CYCLES
+#endif
+
+#if VERNIER==1
+u8                      g_auVernierStartup[8];
+u32                     g_alVernierLow          [FREQ_COUNT];   // the interrupt hits from this frame cycle (tails in)...
+u32                     g_alVernierHigh         [FREQ_COUNT];   // ...and before this one. 0: not found
+#endif
+
+#if JITTER==1
+u32                     g_alJitterFirst     [CALIBRATION_TESTS];                // cycles in the first frame...
+s8                      g_acJitterDelta     [CALIBRATION_TESTS][JITTER_FRAMES]; // ...and the change from the frame before
+u8                      g_auJitterClipped   [CALIBRATION_TESTS];                // changes beyond +-127
+u8                      g_auJitterSamples   [3 * (JITTER_FRAMES + 1)];          // PC-reg and g_uExtraRounds, per VBLANK (customJitterISR)
+u8*                     g_pJitterNext;
+u8*                     g_pJitterEnd;
+#endif
+
+#if CLOCK_CHECK==1
+volatile u16            g_nClockFrames;     // written by customClockISR...
+volatile u32            g_lClockVBLFirst;   // ...loop rounds at the first VBLANK...
+volatile u32            g_lClockVBLLast;    // ...and at the last one
+u32                     g_lClockIter;       // by runClockWindow
+u32                     g_alClockIter       [FREQ_COUNT];
+u32                     g_alClockVBL        [FREQ_COUNT];   // rounds from the first VBLANK to the last
+u16                     g_anClockFrames     [FREQ_COUNT];
+#endif
+
+#if LINE_PROFILE==1
+                        // Sums over NUM_ITERATIONS per segment, for the calibration tests and then the VDP tests
+u16                     g_anProfileInstr        [CALIBRATION_TESTS + MATRIX_MAX_TESTS][PROFILE_SAMPLES - 1];
+u8                      g_auProfileXtra         [CALIBRATION_TESTS + MATRIX_MAX_TESTS][PROFILE_SAMPLES - 1];
+#endif
+
+#if CMD_CONTENTION==1 || V9958_WTE==1
+bool                    g_bCmdLoad;         // runIteration starts g_auContentionCmd before each frame
+#endif
+
+#if CMD_CONTENTION==1
+fix8                    g_axContentionCost      [2][MATRIX_MAX_TESTS];  // 0: idle, 1: busy
+#endif
+
+#if V9958_WTE==1
+bool                    g_bWaitRun;         // false if not a V9958
+fix8                    g_axWaitCost            [2][2][MATRIX_MAX_TESTS];   // [WTE][idle, busy]
+#endif
+
+#if VDP_CMD_BENCH==1
+u8                      g_auVDPCmd[15];     // R#32-R#46
+u32                     g_alCmdPixels           [arraysize(g_auCmdModes)][MATRIX_VARIANTS][arraysize(g_auCmdCodes)]; // per frame, 0: not run
+#endif
+
+#if VRAM_MATRIX==1
+fix8                    g_axMatrixCost          [arraysize(g_auMatrixModes)][MATRIX_VARIANTS][MATRIX_MAX_TESTS]; // 0: not run
+#endif
 
 // --------------------------------------------------------------------------
 // Specials in case of ROM outfile
@@ -478,10 +1014,12 @@ void                    UPPERCODE_END(void); // used for getting address only!
 void                    establishSlotIDsNI_fromC(void);
 void                    memAPI_enaSltPg0_NI_fromC(u8 uSlotID);
 void                    memAPI_enaSltPg2_NI_fromC(u8 uSlotID);
+void                    memAPI_setMapperPg2_NI_fromC(u8 uSegment);
 
 u8 __at(0x0038)         g_uInt38;           // In ROM mode there is NO JP at this address initially
 
 u8 __at(0xF3AE)         g_uBIOS_LINL40;     // LINL40, MSX BIOS for width/columns
+u8 __at(0xFCC1)         g_auBIOS_EXPTBL[4]; // EXPTBL, bit 7: primary slot is expanded
 
 
 u8                      g_uSlotidPage0BIOS;
@@ -574,60 +1112,169 @@ __asm macroTEST_B_STARTUP __endasm;
 void TEST_B_UNROLL(void) __naked {
 __asm macroTEST_B_UNROLL __endasm;
 }
-void TEST_LONGTEST_UNROLL(void) __naked {
-__asm macroTEST_LONG_UNROLL __endasm;
+
+// ---------------------------------------------------------------------------
+// Special rounding. Caters for the 3rd decimal already presented to user
+// rounded up (using +0.005). Just to avoid making it look like a bug.
+//
+s8 signedRoundX(fix8 x)
+{
+    return x<0?-(s8)((-x+128) >> FIX_SHIFT):(s8)((x+129) >> FIX_SHIFT); // 129: 0.505
+}
+
+// ---------------------------------------------------------------------------
+//
+u32 unsignedRound(fix8 x)
+{
+    return (u32)(x+128) >> FIX_SHIFT;
+}
+
+// ---------------------------------------------------------------------------
+//
+u32 abs32(s32 s)
+{
+    return s<0?-s:s;
 }
-void TEST_LONGTEST_TAIL(void) __naked {
-__asm macroTEST_LONG_TAIL __endasm;
+
+// ---------------------------------------------------------------------------
+//
+u8 abs(s8 s)
+{
+    return s<0?-s:s;
 }
 
 // ---------------------------------------------------------------------------
+// lNum/lDen as fix8, rounded. Long division on the last 8 bits, so neither
+// side needs to be shifted up front (and overflow)
 //
-u32 getTimeStamp(void)
+fix8 fixDiv(u32 lNum, u32 lDen)
 {
-    u32 lSL = (u32)readClock(0);
-    u32 lSH = (u32)readClock(1);
-    u32 lML = (u32)readClock(2);
-    u32 lMH = (u32)readClock(3);
+    u32 lQ = lNum / lDen;
+    u32 lR = lNum % lDen;
+
+    for(u8 i = 0; i < FIX_SHIFT; i++)
+    {
+        lR <<= 1;
+        lQ <<= 1;
+
+        if(lR >= lDen)
+        {
+            lR -= lDen;
+            lQ |= 1;
+        }
+    }
+
+    if(lR >= lDen - lR)         // half a 1/256 or more left
+        lQ++;
 
-    return (lMH<<24)|(lML<<16)|(lSH<<8)|lSL;
+    return (fix8)lQ;
 }
 
 // ---------------------------------------------------------------------------
-// Special rounding. Caters for the 3rd decimal already presented to user
-// rounded up (using +0.005). Just to avoid making it look like a bug.
+// Saturates at FIX_SAT
+//
+u32 mulSat(u32 l1, u32 l2)
+{
+    if(l1 != 0 && l2 > FIX_SAT / l1)
+        return FIX_SAT;
+
+    return l1 * l2;
+}
+
+// ---------------------------------------------------------------------------
+// Integer square root, bit by bit
 //
-s8 signedRoundX(float f)
+u16 isqrt32(u32 l)
 {
-    return f<0?(s8)(f-0.5):(s8)(f+0.505);
+    u32 lRes = 0;
+    u32 lBit = (u32)1 << 30;
+
+    while(lBit > l)
+        lBit >>= 2;
+
+    while(lBit != 0)
+    {
+        if(l >= lRes + lBit)
+        {
+            l -= lRes + lBit;
+            lRes = (lRes >> 1) + lBit;
+        }
+        else
+        {
+            lRes >>= 1;
+        }
+
+        lBit >>= 2;
+    }
+
+    return (u16)lRes;
 }
 
 // ---------------------------------------------------------------------------
+// Cost of the unroll instruction(s) in the cycles of the active CPU
 //
-float unsignedRound(float f)
+u8 getRealSingleCost(u8 uTest)
 {
-    return (float)((u32)(f+0.5));
+    return isR800(g_eCPUMode) ? g_aoTest[uTest].uRealSingleCostR800 : g_aoTest[uTest].uRealSingleCost;
 }
 
 // ---------------------------------------------------------------------------
+// Cost of the startup block in the cycles of the active CPU
 //
-u32 abs32(s32 s)
+u8 getStartupCycleCost(u8 uTest)
 {
-    return s<0?-s:s;
+    return isR800(g_eCPUMode) ? g_aoTest[uTest].uStartupCycleCostR800 : g_aoTest[uTest].uStartupCycleCost;
 }
 
 // ---------------------------------------------------------------------------
+// Cost of macroTEST_TAIL in the cycles of the active CPU
 //
-u8 abs(s8 s)
+u8 getTailCycleCost(void)
 {
-    return s<0?-s:s;
+#if SELF_CALIBRATION==1
+    if(g_bSelfCalibrated)
+        return (u8)unsignedRound(g_xTailCycles);
+#endif
+
+    if(isR800(g_eCPUMode))
+        return FRAME_CYCLES_TAIL_R800;
+
+    u8 uFrmCycles = FRAME_CYCLES_TAIL_Z80;
+    if(g_eCPUMode == Z80_TURBO )
+        uFrmCycles += FRAME_CYCLES_TAIL_Z80_TURBO_ADD;
+
+    return uFrmCycles;
 }
 
 // ---------------------------------------------------------------------------
+// Everything in a frame which is not the unrolled instructions: ISR, the
+// kick-off of it, commonStartForAllTests and the startup block of the first
+// test
 //
-float fmax(float f1, float f2)
+u16 getFrameOverheadCycles(void)
 {
-    return f1>f2?f1:f2;
+    u16 nIOWait = 0;
+
+#if SELF_CALIBRATION==1
+    if(g_bSelfCalibrated)
+        nIOWait = (u16)unsignedRound(CALIB_ISR_VDP_IO * g_xVDPIOWait);
+#endif
+
+    if(isR800(g_eCPUMode))
+        return (u16)FRAME_CYCLES_INT_R800 + FRAME_CYCLES_INT_KICK_OFF_R800 + FRAME_CYCLES_COMMON_START_R800 + getStartupCycleCost(0) + nIOWait;
+
+    u16 nTotalOverhead = (u16)FRAME_CYCLES_INT + FRAME_CYCLES_INT_KICK_OFF + FRAME_CYCLES_COMMON_START + g_aoTest[0].uStartupCycleCost;
+
+    if(g_eCPUMode == Z80_TURBO )
+    {
+        nTotalOverhead += FRAME_CYCLES_INT_TURBO_ADD + FRAME_CYCLES_INT_KICK_OFF_TURBO_ADD + FRAME_CYCLES_COMMON_START_TURBO_ADD;
+#if SELF_CALIBRATION==1
+        if(g_bSelfCalibrated)
+            nTotalOverhead -= 3 * (32);     // the assumed wait in FRAME_CYCLES_INT_TURBO_ADD, nIOWait is measured
+#endif
+    }
+
+    return nTotalOverhead + nIOWait;        // plain Z80 assumes no wait, but has what was measured
 }
 
         
@@ -636,7 +1283,9 @@ void setCustomISR(void)
 {
     disableInterrupt();
 
-#ifdef ROM_OUTPUT_FILE
+#if USE_IM2==1
+    setInterruptModeNI(g_uIM2Table);    // page 0 stays as it is, BIOS in ROM mode
+#elif defined(ROM_OUTPUT_FILE)
     memAPI_enaSltPg0_NI_fromC(g_uSlotidPage0RAM);
 #endif
 
@@ -652,7 +1301,9 @@ void restoreOriginalISR(void)
     disableInterrupt();
     g_pInterrupt = g_pInterruptOrg;
 
-#ifdef ROM_OUTPUT_FILE
+#if USE_IM2==1
+    setInterruptModeNI(0);              // the BIOS at 0x0038 again
+#elif defined(ROM_OUTPUT_FILE)
     memAPI_enaSltPg0_NI_fromC(g_uSlotidPage0BIOS);
 #endif
 
@@ -660,71 +1311,365 @@ void restoreOriginalISR(void)
 }
 
 // ---------------------------------------------------------------------------
-// If line is greater than 80 chars, cut at 80 (to avoid 80 char strings with
-// "\r\n" at the end (after pos 80), inserting an unwanted line). Does only work on RAM strings ofc
-void printX(u8* sz)
+// Swap between VBLANK and line interrupts. Both ISRs are custom, so this must
+// be called between setCustomISR() and restoreOriginalISR()
+//
+void enableLineInterrupts(bool bEnable)
 {
-    u8 l = strlen(sz);
-    if((l >= 80) && (*(sz + 79) >= ' ') )
-        *(sz + 80) = 0;
-
-    print(sz);
-}
+    disableInterrupt();
 
-// ---------------------------------------------------------------------------
-void enableR800FullSpeedIfAvailable(bool bEnable)
-{
-    if(getMSXType() == 3) // MSX turbo R
-        changeCPU(bEnable ? 2 : 0); // 0=Z80 (ROM) mode, 1=R800 ROM  mode, 2=R800 DRAM mode
-}
+    if(bEnable)
+    {
+        g_pInterrupt = &customLineISR;
+        writeVDPRegNI(g_uBIOS_RG1SAV & ~0x20, 1);   // IE0 off
+        writeVDPRegNI(g_uBIOS_RG0SAV | 0x10, 0);    // IE1 on
+    }
+    else
+    {
+        writeVDPRegNI(g_uBIOS_RG0SAV, 0);
+        writeVDPRegNI(g_uBIOS_RG1SAV, 1);
+        g_pInterrupt = &customISR;
+    }
 
-// ---------------------------------------------------------------------------
-void enableTurboIfAvailable(bool bEnable)
-{
-    if(hasTurboFeature())
-        enableTurbo(bEnable);
+    enableInterrupt();
 }
 
 // ---------------------------------------------------------------------------
-// Just set write address to upper 64kB area. We will not see this garbage
-// on screen while in DOS prompt/screen
-void prepareVDP(enum three_way eRead)
+// Variants of the matrix and the command engine benchmark. Bit 0: sprites
+// off (R#8 SPD), bit 1: display off (R#1 BL). The mirrors are kept in sync
+//
+void setSpritesAndDisplay(u8 uVariant)
 {
     disableInterrupt();
-
-    if(eRead == NO) // == Write
-        setVRAMAddressNI(1 | 0x40, 0x0000);
-    else if(eRead == YES) // ignore if NA
-        setVRAMAddressNI(1 | 0x00, 0x0000);
-
+    g_uBIOS_RG8SAV = (uVariant & 1) ? (g_uBIOS_RG8SAV | 0x02) : (g_uBIOS_RG8SAV & ~0x02);
+    g_uBIOS_RG1SAV = (uVariant & 2) ? (g_uBIOS_RG1SAV & ~0x40) : (g_uBIOS_RG1SAV | 0x40);
+    writeVDPRegNI(g_uBIOS_RG8SAV, 8);
+    writeVDPRegNI(g_uBIOS_RG1SAV, 1);
     enableInterrupt();
 }
 
 // ---------------------------------------------------------------------------
-// For DOS mode: Copy test in at runTestAsmInMem, X amount of unrolleds
-// Some tests are forced to run in RAM (i.e. dos mode). Like the first run.
-// As this seem to be the fastest, most accurate and reliable way to measure
-// the speed.
+// Small replacement for sprintf, with what the reports use only: %s %c %d %u
+// %X, the l-modifier, the flags '-', '+' and '0' and a width. No floats (see
+// fixToIntWith2Decimals). Returns the length, as sprintf.
 //
-void setupTestInMemoryDOS(u8 uTest)
+u8 formatText(u8* pBuf, const u8* szFmt, ...)
 {
-    u16 nMax = (u16)((u32)(0x4000 - SIZE_TAIL_BLOCK) / g_aoTest[uTest].uUnrollInstructionsSize);
-    u8* p = (u8*) &runTestAsmInMem;
+    va_list ap;
+    u8 auDigits[12];
+    u8* p = pBuf;
 
-    for(u16 n = 0; n < nMax; n++)
+    va_start(ap, szFmt);
+
+    while(*szFmt != 0)
     {
-        memcpy(p, *g_aoTest[uTest].pFncUnrollInstruction, g_aoTest[uTest].uUnrollInstructionsSize);
-        p += g_aoTest[uTest].uUnrollInstructionsSize;
-    }
+        if(*szFmt != '%')
+        {
+            *p++ = *szFmt++;
+            continue;
+        }
 
-    memcpy(p, &TEST_TAIL, SIZE_TAIL_BLOCK);
-}
+        szFmt++;
 
-// ---------------------------------------------------------------------------
-// For ROM mode: Set correct segment (tests already present in seg) in page 2
-// (runTestAsmInMem is within the segment). If the test is the "baseline"-test
-// (the first test), we run this using RAM in page 2, as RAM is most precise.
-// (external (flash-)ROMs may introduce latency)
+        bool bLeft = false;
+        bool bPlus = false;
+        u8 uPad = ' ';
+        u8 uWidth = 0;
+
+        for(;; szFmt++)
+        {
+            if(*szFmt == '-')
+                bLeft = true;
+            else if(*szFmt == '+')
+                bPlus = true;
+            else if(*szFmt == '0')
+                uPad = '0';
+            else
+                break;
+        }
+
+        while(*szFmt >= '0' && *szFmt <= '9')
+            uWidth = uWidth * 10 + *szFmt++ - '0';
+
+        bool bLong = *szFmt == 'l';
+        if(bLong)
+            szFmt++;
+
+        u8 c = *szFmt++;
+        u8 uSign = 0;
+        const u8* pSrc = auDigits + sizeof(auDigits) - 1;
+        auDigits[sizeof(auDigits) - 1] = 0;
+
+        if(c == 's')
+        {
+            pSrc = va_arg(ap, const u8*);
+        }
+        else if(c == 'c')
+        {
+            *(u8*)--pSrc = (u8)va_arg(ap, int);
+        }
+        else if(c == 'd' || c == 'u' || c == 'X')
+        {
+            u32 l;
+
+            if(bLong)
+                l = va_arg(ap, u32);
+            else
+                l = c == 'd' ? (u32)(s32)va_arg(ap, int) : (u16)va_arg(ap, int);
+
+            if(c == 'd' && (s32)l < 0)
+            {
+                uSign = '-';
+                l = -(s32)l;
+            }
+            else if(c == 'd' && bPlus)
+            {
+                uSign = '+';
+            }
+
+            u8 uBase = c == 'X' ? 16 : 10;
+            do
+            {
+                u8 uDigit = (u8)(l % uBase);
+                *(u8*)--pSrc = uDigit < 10 ? '0' + uDigit : 'A' - 10 + uDigit;
+                l /= uBase;
+            }
+            while(l != 0);
+        }
+        else    // %% and anything unknown
+        {
+            *p++ = c;
+            continue;
+        }
+
+        u8 uLen = strlen(pSrc) + (uSign != 0);
+
+        if(!bLeft)
+        {
+            if(uSign != 0 && uPad == '0')
+            {
+                *p++ = uSign;
+                uSign = 0;
+            }
+
+            for(; uWidth > uLen; uWidth--)
+                *p++ = uPad;
+        }
+
+        if(uSign != 0)
+            *p++ = uSign;
+
+        while(*pSrc != 0)
+            *p++ = *pSrc++;
+
+        for(; uWidth > uLen; uWidth--)
+            *p++ = ' ';
+    }
+
+    *p = 0;
+    va_end(ap);
+
+    return (u8)(p - pBuf);
+}
+
+// ---------------------------------------------------------------------------
+// Scroll the text screen one row up, and clear the last row
+//
+void scrollText(u8 uRows, u8 uWidth)
+{
+    u16 nAddr = g_nBIOS_TXTNAM;
+
+    for(u8 r = 1; r < uRows; r++)
+    {
+        disableInterrupt();
+        setVRAMAddressNI(0x00, nAddr + uWidth);
+        readVRAMNI(uWidth, g_auTextRow);
+        setVRAMAddressNI(0x40, nAddr);
+        writeVRAMNI(uWidth, g_auTextRow);
+        enableInterrupt();
+
+        nAddr += uWidth;
+    }
+
+    memset(g_auTextRow, ' ', uWidth);
+
+    disableInterrupt();
+    setVRAMAddressNI(0x40, nAddr);
+    writeVRAMNI(uWidth, g_auTextRow);
+    enableInterrupt();
+}
+
+// ---------------------------------------------------------------------------
+// Same semantics as BIOS CHPUT for what we print: \r, \n, wrapping after the
+// last column and scrolling. SCREEN 0 (width 40 or 80) is written straight
+// into the name table, a run of characters at a time. Anything else is left
+// to the BIOS. The cursor position is kept in the BIOS variables, so the two
+// can be mixed, and DOS continues where we left.
+//
+void print(u8* szMessage)
+{
+    u8 uWidth = g_uBIOS_LINLEN;
+
+    if(g_uBIOS_SCRMOD != 0 || (uWidth != 40 && uWidth != 80))
+    {
+        printBIOS(szMessage);
+        return;
+    }
+
+    u8 uRows = g_uBIOS_CRTCNT - (g_uBIOS_CNSDFG != 0 ? 1 : 0);
+    u8 x = g_uBIOS_CSRX;
+    u8 y = g_uBIOS_CSRY;
+    u8* p = szMessage;
+
+    while(*p != 0)
+    {
+        bool bNewline = false;
+
+        if(*p == '\r')
+        {
+            x = 1;
+            p++;
+        }
+        else if(*p == '\n')
+        {
+            bNewline = true;
+            p++;
+        }
+        else
+        {
+            u8 uLen = 0;
+
+            while(p[uLen] >= ' ' && x + uLen <= uWidth)
+                uLen++;
+
+            if(uLen == 0)   // other control characters are not used, skip
+            {
+                p++;
+                continue;
+            }
+
+            disableInterrupt();
+            setVRAMAddressNI(0x40, g_nBIOS_TXTNAM + (u16)(y - 1) * uWidth + x - 1);
+            writeVRAMNI(uLen, p);
+            enableInterrupt();
+
+            p += uLen;
+            x += uLen;
+
+            if(x > uWidth)  // wrap, as CHPUT
+            {
+                x = 1;
+                bNewline = true;
+            }
+        }
+
+        if(bNewline)
+        {
+            if(y < uRows)
+                y++;
+            else
+                scrollText(uRows, uWidth);
+        }
+    }
+
+    g_uBIOS_CSRX = x;
+    g_uBIOS_CSRY = y;
+}
+
+// ---------------------------------------------------------------------------
+// If line is greater than 80 chars, cut at 80 (to avoid 80 char strings with
+// "\r\n" at the end (after pos 80), inserting an unwanted line). Does only work on RAM strings ofc
+void printX(u8* sz)
+{
+    u8 l = strlen(sz);
+    if((l >= 80) && (*(sz + 79) >= ' ') )
+        *(sz + 80) = 0;
+
+    print(sz);
+}
+
+// ---------------------------------------------------------------------------
+void enableR800FullSpeedIfAvailable(bool bEnable)
+{
+    if(getMSXType() == 3) // MSX turbo R
+        changeCPU(bEnable ? 2 : 0); // 0=Z80 (ROM) mode, 1=R800 ROM  mode, 2=R800 DRAM mode
+}
+
+// ---------------------------------------------------------------------------
+void enableTurboIfAvailable(bool bEnable)
+{
+    if(hasTurboFeature())
+        enableTurbo(bEnable);
+}
+
+// ---------------------------------------------------------------------------
+// The palette registers can't be read, but the BIOS keeps a copy in VRAM
+// (COLOR=, SETPLT). Unlike initPalette(), this keeps a custom palette as is.
+//
+void savePalette(void)
+{
+    u16 nAddr = (g_uBIOS_SCRMOD == 0 && g_uBIOS_LINLEN > 40) ? 0x0F00 : g_anPaletteTable[g_uBIOS_SCRMOD];
+
+    disableInterrupt();
+    setVRAMAddressNI(0x00, nAddr);
+    readVRAMNI(sizeof(g_auPalette), g_auPalette);
+    enableInterrupt();
+}
+
+// ---------------------------------------------------------------------------
+// Undo what the port tests leave behind: out9A trashes the palette, and out9B
+// leaves R#17 in non-increment mode. in99 selects S#3, but the ISRs go back to
+// S#0 anyway. Cheap, so it is done after every test.
+//
+void restoreVDPAfterTest(void)
+{
+    disableInterrupt();
+    writeVDPRegNI(g_uBIOS_RG17SAV, 17);
+    writeVDPRegNI(0, 16);               // palette pointer
+    writePaletteNI(g_auPalette);
+    enableInterrupt();
+}
+
+// ---------------------------------------------------------------------------
+// Just set write address to upper 64kB area. We will not see this garbage
+// on screen while in DOS prompt/screen
+void prepareVDP(enum three_way eRead)
+{
+    disableInterrupt();
+
+    if(eRead == NO) // == Write
+        setVRAMAddressNI(1 | 0x40, 0x0000);
+    else if(eRead == YES) // ignore if NA
+        setVRAMAddressNI(1 | 0x00, 0x0000);
+
+    enableInterrupt();
+}
+
+// ---------------------------------------------------------------------------
+// For DOS mode: Copy test in at runTestAsmInMem, X amount of unrolleds
+// Some tests are forced to run in RAM (i.e. dos mode). Like the first run.
+// As this seem to be the fastest, most accurate and reliable way to measure
+// the speed.
+//
+void setupTestInMemoryDOS(u8 uTest)
+{
+    u16 nMax = (u16)((u32)(0x4000 - SIZE_TAIL_BLOCK) / g_aoTest[uTest].uUnrollInstructionsSize);
+    u8* p = (u8*) &runTestAsmInMem;
+
+    for(u16 n = 0; n < nMax; n++)
+    {
+        memcpy(p, *g_aoTest[uTest].pFncUnrollInstruction, g_aoTest[uTest].uUnrollInstructionsSize);
+        p += g_aoTest[uTest].uUnrollInstructionsSize;
+    }
+
+    memcpy(p, &TEST_TAIL, SIZE_TAIL_BLOCK);
+}
+
+// ---------------------------------------------------------------------------
+// For ROM mode: Set correct segment (tests already present in seg) in page 2
+// (runTestAsmInMem is within the segment). If the test is the "baseline"-test
+// (the first test), we run this using RAM in page 2, as RAM is most precise.
+// (external (flash-)ROMs may introduce latency)
 //
 #ifdef ROM_OUTPUT_FILE
 void setupTestInMemoryROM(u8 uTest)
@@ -760,301 +1705,2819 @@ void setupTestInMemory(u8 uTest)
 }
 
 // ---------------------------------------------------------------------------
-void runIteration(enum freq_variant eFreq, u8 uTest, u8 uIterationNum)
+// Instructions run in the frame, from the PC-reg stored by customISR and the
+// extra rounds
+//
+u32 getFrameInstructions(u8 uUnrollInstrSize, u8 uUnrollSingleInstrSize)
+{
+    u16 nLength = (u16)g_pPCReg - (u16)&runTestAsmInMem;
+    u32 lInstructions = nLength / uUnrollSingleInstrSize;
+
+    if(g_uExtraRounds != 0)
+    {
+        // u32 lTestBlocksInSegment = ((u32)(0x4000 - SIZE_TAIL_BLOCK) / uUnrollInstrSize);
+        u32 lTestBlocksInSegment = (u32)0x4000 / uUnrollInstrSize; // the above should be correct, but this one seems to empirically hit better (no decimals)
+        lTestBlocksInSegment = (lTestBlocksInSegment * uUnrollInstrSize) / uUnrollSingleInstrSize; // two divs on purpose
+        u32 lBlockCost = lTestBlocksInSegment * g_uExtraRounds;
+
+        lInstructions += lBlockCost;
+    }
+
+    return lInstructions;
+}
+
+// ---------------------------------------------------------------------------
+//
+void resetStats(StreamStats* pStats)
+{
+    memset(pStats, 0, sizeof(StreamStats));
+    pStats->lMin = (u32)-1; // Wraps around to maximum u32 value
+}
+
+// ---------------------------------------------------------------------------
+// Streaming statistics: min, max and the extra rounds are updated right away.
+// The sample also goes into g_alWindow (insertion sort), which only holds the
+// test currently running. The sums are taken from it (calcIterationStats).
+//
+void addSample(StreamStats* pStats, u32 lSample, u8 uXtra)
+{
+    if(lSample < pStats->lMin)
+        pStats->lMin = lSample;
+
+    if(lSample > pStats->lMax)
+        pStats->lMax = lSample;
+
+    if(uXtra > pStats->uXtraMax)
+        pStats->uXtraMax = uXtra;
+
+    u8 j = pStats->uCount++;
+
+    for(; j > 0 && g_alWindow[j - 1] > lSample; j--)
+        g_alWindow[j] = g_alWindow[j - 1];
+
+    g_alWindow[j] = lSample;
+}
+
+// ---------------------------------------------------------------------------
+void runIteration(enum freq_variant eFreq, u8 uTest)
+{
+    prepareVDP(g_aoTest[uTest].eReadVRAM);
+
+#if CMD_CONTENTION==1 || V9958_WTE==1
+    if(g_bCmdLoad)  // before the halt in commonStartForAllTests, the command outlasts the frame measured
+    {
+        disableInterrupt();
+        startVDPCommandNI(g_auContentionCmd);
+        enableInterrupt();
+    }
+#endif
+
+    commonStartForAllTests();
+
+    addSample(&g_aoFrameStats[eFreq][uTest],
+              getFrameInstructions(g_aoTest[uTest].uUnrollInstructionsSize, g_aoTest[uTest].uUnrollSingleInstructionSize),
+              g_uExtraRounds);
+}
+
+// ---------------------------------------------------------------------------
+// Line interrupt timebase: one frame gives LINE_SAMPLES positions in the
+// unrolled block, LINE_INT_STEP lines apart. The differences between them are
+// the samples. Quantisation to whole instructions cancels out between
+// neighbouring samples, hence no FRAME_COUNT_ADD_UP here.
+//
+void startLineIteration(u8 uTest)
 {
     prepareVDP(g_aoTest[uTest].eReadVRAM);
 
+    disableInterrupt();
+    g_uLineSample  = 0;
+    g_uLineIntNext = LINE_INT_FIRST;
+    writeVDPRegNI(LINE_INT_FIRST, 19);
+    writeVDPRegNI(g_uBIOS_RG0SAV | 0x10, 0);    // IE1 on, customLineISR turns it off after the last sample
+    enableInterrupt();
+
     commonStartForAllTests();
+}
 
+// ---------------------------------------------------------------------------
+// Position of a line sample, in instructions from the start of the frame
+//
+u32 getLineSamplePos(u8 uTest, u8 uSample)
+{
     u8 uUnrollSingleInstrSize = g_aoTest[uTest].uUnrollSingleInstructionSize;
     u8 uUnrollInstrSize = g_aoTest[uTest].uUnrollInstructionsSize;
+    u16 nMax = (u16)((u32)(0x4000 - SIZE_TAIL_BLOCK) / uUnrollInstrSize);
+    u32 lBlockInstructions = (u32)nMax * uUnrollInstrSize / uUnrollSingleInstrSize;
+    u16 nLength = g_anLinePC[uSample] - (u16)&runTestAsmInMem;
 
-    u16 nLength = (u16)g_pPCReg - (u16)&runTestAsmInMem;
-    u32 lInstructions = nLength / uUnrollSingleInstrSize;
+    return g_auLineXtra[uSample] * lBlockInstructions + nLength / uUnrollSingleInstrSize;
+}
 
-    g_auFrameInstrResultXtra[eFreq][uTest][uIterationNum] = g_uExtraRounds;
+// ---------------------------------------------------------------------------
+void runLineIteration(enum freq_variant eFreq, u8 uTest)
+{
+    startLineIteration(uTest);
 
-    if(g_uExtraRounds != 0)
+    u32 lPrev = 0;
+    for(u8 s = 0; s < LINE_SAMPLES; s++)
+    {
+        u32 lPos = getLineSamplePos(uTest, s);
+
+        if(s != 0)
+        {
+            u16 nInstructions = (u16)(lPos - lPrev);
+
+            g_alLineInstrSum[eFreq][uTest] += nInstructions;
+            g_anLineXtraSum[eFreq][uTest]  += (u8)(g_auLineXtra[s] - g_auLineXtra[s-1]);
+
+            if(nInstructions < g_anLineInstrMin[eFreq][uTest])
+                g_anLineInstrMin[eFreq][uTest] = nInstructions;
+
+            if(nInstructions > g_anLineInstrMax[eFreq][uTest])
+                g_anLineInstrMax[eFreq][uTest] = nInstructions;
+        }
+
+        lPrev = lPos;
+    }
+}
+
+#if LINE_PROFILE==1
+// ---------------------------------------------------------------------------
+// As runLineIteration, but every segment (LINE_INT_STEP lines) is kept apart.
+// uRow is the row in g_anProfileInstr
+//
+void runProfileIteration(u8 uRow, u8 uTest)
+{
+    startLineIteration(uTest);
+
+    u32 lPrev = 0;
+    for(u8 s = 0; s < PROFILE_SAMPLES; s++)
+    {
+        u32 lPos = getLineSamplePos(uTest, s);
+
+        if(s != 0)
+        {
+            g_anProfileInstr[uRow][s - 1] += (u16)(lPos - lPrev);
+            g_auProfileXtra[uRow][s - 1]  += (u8)(g_auLineXtra[s] - g_auLineXtra[s - 1]);
+        }
+
+        lPrev = lPos;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Calibration tests and VDP tests, at 60 Hz, with samples down to line 248.
+// Line interrupts must be active.
+//
+void runLineProfile(void)
+{
+    g_uLineSamples = PROFILE_SAMPLES;
+
+    setPALRefreshRate(false);
+    enableLineInterrupts(true);
+    halt();
+
+    memset(g_anProfileInstr, 0, sizeof(g_anProfileInstr));
+    memset(g_auProfileXtra, 0, sizeof(g_auProfileXtra));
+
+    u8 uRow = 0;
+    for(u8 t = 0; t < arraysize(g_aoTest) && uRow < CALIBRATION_TESTS + MATRIX_MAX_TESTS; t++)
+    {
+        if(t >= CALIBRATION_TESTS && !g_aoTest[t].bVDPPort)
+            continue;
+
+        setupTestInMemory(t);
+
+        for(u8 i = 0; i < NUM_ITERATIONS; i++)
+            runProfileIteration(uRow, t);
+
+        uRow++;
+    }
+
+    g_uLineSamples = LINE_SAMPLES;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Runs all tests again, using line interrupts. Custom ISR must be active.
+//
+void runAllLineIterations(void)
+{
+    g_uLineIntStep  = LINE_INT_STEP;
+    g_uLineSamples  = LINE_SAMPLES;
+
+    for(enum freq_variant f = 0; f < FREQ_COUNT; f++)
+    {
+        setPALRefreshRate((bool)f);
+        enableLineInterrupts(true);                 // again, as they are off after each run
+        halt();
+
+        for(u8 t = 0; t < arraysize(g_aoTest); t++)
+        {
+            setupTestInMemory(t);
+
+            g_alLineInstrSum[f][t] = 0;
+            g_anLineXtraSum[f][t]  = 0;
+            g_anLineInstrMin[f][t] = 0xFFFF;
+            g_anLineInstrMax[f][t] = 0;
+
+            for(u8 i = 0; i < NUM_ITERATIONS; i++)
+                runLineIteration(f, t);
+
+            restoreVDPAfterTest();
+        }
+    }
+
+#if LINE_PROFILE==1
+    runLineProfile();
+#endif
+
+    enableLineInterrupts(false);
+}
+
+// ---------------------------------------------------------------------------
+// S1990 timebase: run from two different entry points in the unrolled block,
+// the full block and the last half of it. The overhead around the runs is
+// identical, so the difference is the cost of the first half only.
+//
+void runTimedIteration(enum freq_variant eFreq, u8 uTest)
+{
+    u8 uUnrollInstrSize = g_aoTest[uTest].uUnrollInstructionsSize;
+    u16 nMax = (u16)((u32)(0x4000 - SIZE_TAIL_BLOCK) / uUnrollInstrSize);
+    u8* pTail = (u8*)&runTestAsmInMem + nMax * uUnrollInstrSize;
+
+    u32 lFull = 0;
+    u32 lHalf = 0;
+
+    for(u8 i = 0; i < NUM_ITERATIONS; i++)
+    {
+        prepareVDP(g_aoTest[uTest].eReadVRAM);
+        lFull += runTimedS1990(pTail - nMax * uUnrollInstrSize);
+
+        prepareVDP(g_aoTest[uTest].eReadVRAM);
+        lHalf += runTimedS1990(pTail - (nMax/2) * uUnrollInstrSize);
+    }
+
+    g_alTimerTicksFull[eFreq][uTest] = lFull;
+    g_alTimerTicksHalf[eFreq][uTest] = lHalf;
+}
+
+// ---------------------------------------------------------------------------
+// S1990 timebase: no instruction counting, the cost comes directly from the
+// timer. The frame length is timed too, so the "Framecycles" line has a value.
+//
+void calcStatisticsS1990(void)
+{
+    u8 uCyclesPerTick = auS1990_CYCLES_PER_TICK[g_eCPUMode];
+
+    for(u8 f = 0; f < FREQ_COUNT; f++)
+    {
+        g_axFrmTotalCycles[f] = toFix((u32)g_anTimerFrameTicks[f] * uCyclesPerTick) / TIMER_FRAMES;
+
+        for(u8 t = 0; t < arraysize(g_aoTest); t++)
+        {
+            u8 uUnrollInstrSize = g_aoTest[t].uUnrollInstructionsSize;
+            u16 nMax = (u16)((u32)(0x4000 - SIZE_TAIL_BLOCK) / uUnrollInstrSize);
+            u32 lInstructions = (u32)(nMax - nMax/2) * uUnrollInstrSize / g_aoTest[t].uUnrollSingleInstructionSize;
+
+            g_axFinalTestCost[f][t] = fixDiv((g_alTimerTicksFull[f][t] - g_alTimerTicksHalf[f][t]) * uCyclesPerTick, lInstructions * NUM_ITERATIONS);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// _customLineISR and the kick-off of it, in the cycles of the active CPU
+//
+u16 getLineIntOverheadCycles(void)
+{
+    if(isR800(g_eCPUMode))
+        return FRAME_CYCLES_LINE_INT_R800;
+
+    u16 nOverhead = FRAME_CYCLES_LINE_INT;
+
+    if(g_eCPUMode == Z80_TURBO )
+        nOverhead += FRAME_CYCLES_LINE_INT_TURBO_ADD + FRAME_CYCLES_INT_KICK_OFF_TURBO_ADD;
+
+    return nOverhead;
+}
+
+// ---------------------------------------------------------------------------
+// Every sample holds one line ISR, and macroTEST_TAIL as many times as the
+// extra rounds moved. The sync tests give the length of a sample in cycles,
+// and from that: cycles per line and the cost of the rest of the tests.
+//
+void calcLineStatistics(void)
+{
+    u16 nOverhead = getLineIntOverheadCycles();
+    u8 uTail = getTailCycleCost();
+    u16 nSamples = NUM_ITERATIONS * (LINE_SAMPLES - 1);
+
+    for(u8 f = 0; f < FREQ_COUNT; f++)
+    {
+        u32 lCycles = 0;    // all samples of the calibration tests, without the line ISR
+
+        for(u8 t = 0; t < CALIBRATION_TESTS; t++)
+            lCycles += g_alLineInstrSum[f][t] * getRealSingleCost(t) + (u32)g_anLineXtraSum[f][t] * uTail;
+
+        fix8 xSampleCycles = fixDiv(lCycles, (u32)nSamples * CALIBRATION_TESTS) + toFix(nOverhead);
+
+        g_axLineCyclesPerLine[f] = xSampleCycles / LINE_INT_STEP;
+
+        for(u8 t = 0; t < arraysize(g_aoTest); t++)
+            g_axLineTestCost[f][t] = fixDiv(lCycles - (u32)CALIBRATION_TESTS * g_anLineXtraSum[f][t] * uTail, CALIBRATION_TESTS * g_alLineInstrSum[f][t]);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Statistics of the samples so far of the running test. Samples further away
+// from the median than OUTLIER_PERMILLE are rejected (a late interrupt or so),
+// the rest give avg and the standard deviation. Min/max are of all samples. Returns true when the 95% confidence
+// interval of the average (and by that the cost) is within CI_MAX_PERMILLE.
+//
+bool calcIterationStats(enum freq_variant eFreq, u8 uTest)
+{
+    StreamStats* pStats = &g_aoFrameStats[eFreq][uTest];
+    u8 uCount = pStats->uCount;
+
+    u8 uMid = uCount / 2;
+    u32 lMedian = (uCount & 1) ? g_alWindow[uMid] : (g_alWindow[uMid - 1] + g_alWindow[uMid]) / 2;
+    u32 lLimit = lMedian * OUTLIER_PERMILLE / 1000 + 1; // +1: always accept one instruction of quantisation
+
+    // The sums are of deviations from the median, taken after the outliers are out. Those
+    // left are within lLimit (~700 at most), so the squares can't overflow
+    s32 dSum = 0;
+    u32 lSumSq = 0;
+    u32 lKeptMax = 0;
+    u8 uKept = 0;
+
+    for(u8 i = 0; i < uCount; i++)
+    {
+        s32 d = (s32)(g_alWindow[i] - lMedian);
+
+        if(abs32(d) > lLimit)
+            continue;
+
+        dSum += d;
+        lSumSq += (u32)(d * d);
+        uKept++;
+
+        if(g_alWindow[i] > lKeptMax)
+            lKeptMax = g_alWindow[i];
+    }
+
+    if(uKept == 0)  // only with an even amount, and the two in the middle far apart
+    {
+        uKept = 1;
+        lKeptMax = lMedian;
+    }
+
+    fix8 xAvg = toFix(lMedian) + (dSum < 0 ? -fixDiv(-dSum, uKept) : fixDiv(dSum, uKept));
+
+    // variance = (k*sumsq - sum^2) / (k*(k-1)), deviations are small after the outliers are gone
+    fix8 xVar = 0;
+    if(uKept >= 2)
+    {
+        // In u32, k*sumsq >= sum^2 always. Saturated, the confidence check below fails
+        u32 lAbsSum = abs32(dSum);
+        u32 lVarNum = mulSat(lSumSq, uKept);
+        u32 lSumSq2 = mulSat(lAbsSum, lAbsSum);
+        u16 nVarDen = (u16)uKept * (uKept - 1);
+
+        if(lVarNum == FIX_SAT)
+            xVar = (fix8)0x7FFFFFFF;
+        else if(lVarNum > lSumSq2)
+            xVar = (lVarNum - lSumSq2) / nVarDen >= (u32)1 << (31 - FIX_SHIFT) ? (fix8)0x7FFFFFFF : fixDiv(lVarNum - lSumSq2, nVarDen);
+    }
+
+    if(uTest < CALIBRATION_TESTS) // max out on the calibration tests.
+        g_axFrameInstrResultAvg[eFreq][uTest] = toFix(lKeptMax);
+    else
+        g_axFrameInstrResultAvg[eFreq][uTest] = xAvg;
+
+    g_alFrameInstrResultMed[eFreq][uTest] = lMedian;
+    g_axFrameInstrResultSD[eFreq][uTest]  = xVar < 0x01000000 ? isqrt32((u32)xVar << FIX_SHIFT) : (fix8)isqrt32(xVar) << 4;
+    g_auOutliers[eFreq][uTest] = uCount - uKept;
+
+    if(uKept < 2)
+        return false;
+
+    // t^2 * var < k * bound^2. var is in 1/256, and so is (bound in 1/16)^2. t^2 is x100
+    u32 lBound16 = (u32)xAvg * CI_MAX_PERMILLE / 1000 >> 4;
+    u32 lLeft = mulSat(xVar, g_anStudentT95Sq[uKept - 1]);
+    u32 lRight = mulSat(mulSat(lBound16, lBound16), (u16)uKept * 100);
+
+    return lLeft != FIX_SAT && lLeft < lRight;
+}
+
+// ---------------------------------------------------------------------------
+// Runs a test until calcIterationStats is confident, or MAX_ITERATIONS
+//
+void runAdaptiveIterations(enum freq_variant eFreq, u8 uTest)
+{
+    resetStats(&g_aoFrameStats[eFreq][uTest]);
+
+    for(u8 i = 0; i < MAX_ITERATIONS; i++)
+    {
+        runIteration(eFreq, uTest);
+
+        if(calcIterationStats(eFreq, uTest) && i + 1 >= MIN_ITERATIONS)
+            break;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Frame cycles spent in the unrolled blocks, from the calibration tests
+//
+fix8 getFrameCyclesNoTail(enum freq_variant eFreq)
+{
+#if VERNIER==1
+    // The vernier range has the tails in, take out those that calcStatistics adds
+    if(g_alVernierHigh[eFreq] > g_alVernierLow[eFreq])
+        return toFix(g_alVernierLow[eFreq] + g_alVernierHigh[eFreq]) / 2 -
+               toFix(g_aoFrameStats[eFreq][0].uXtraMax + g_aoFrameStats[eFreq][1].uXtraMax) * getTailCycleCost() / 2;
+#endif
+
+#if SELF_CALIBRATION==1
+    // Each sync test stops somewhere within the instruction after the last one counted. With
+    // different costs the two ranges only partly overlap, and the middle of the overlap is used.
+    // An estimate as FRAME_COUNT_ADD_UP is, only a narrower one. Nothing is measured here, so it
+    // does not depend on runSelfCalibration
+    u8 uCost0 = getRealSingleCost(0);
+    u8 uCost1 = getRealSingleCost(1);
+
+    if(uCost0 != uCost1)
+    {
+        fix8 xLow0 = g_axFrameInstrResultAvg[eFreq][0] * uCost0;
+        fix8 xLow1 = g_axFrameInstrResultAvg[eFreq][1] * uCost1;
+        fix8 xLow  = xLow0 > xLow1 ? xLow0 : xLow1;
+        fix8 xHigh = xLow0 + toFix(uCost0) < xLow1 + toFix(uCost1) ? xLow0 + toFix(uCost0) : xLow1 + toFix(uCost1);
+
+        if(xHigh > xLow)
+            return (xLow + xHigh) / 2;
+    }
+#endif
+
+    return ((g_axFrameInstrResultAvg[eFreq][0] + FRAME_COUNT_ADD_UP) * getRealSingleCost(0) +
+            (g_axFrameInstrResultAvg[eFreq][1] + FRAME_COUNT_ADD_UP) * getRealSingleCost(1)) / 2;
+}
+
+// ---------------------------------------------------------------------------
+//
+fix8 getTestCost(fix8 xFrmCyclesNoTail, enum freq_variant eFreq, u8 uTest)
+{
+    return fixDiv(xFrmCyclesNoTail + toFix((s16)getStartupCycleCost(0) - getStartupCycleCost(uTest)), g_axFrameInstrResultAvg[eFreq][uTest]);
+}
+
+// ---------------------------------------------------------------------------
+// Per test statistics are already in place (calcIterationStats)
+//
+void calcStatistics(void)
+{
+    // Store the first test run as master timing for each frequency
+    for(u8 f = 0; f < FREQ_COUNT; f++)
+    {
+        g_axFrmTotalCyclesNoTail[f] = getFrameCyclesNoTail(f);
+
+        u8 uFrmCycles = getTailCycleCost();
+
+        g_axFrmTotalCycles[f] = g_axFrmTotalCyclesNoTail[f] + toFix(g_aoFrameStats[f][0].uXtraMax + g_aoFrameStats[f][1].uXtraMax) * uFrmCycles / 2;
+    }
+
+    // populate the testcost array
+    for(u8 f = 0; f < FREQ_COUNT; f++)
+        for(u8 t = 0; t < arraysize(g_aoTest); t++)
+            g_axFinalTestCost[f][t] = getTestCost(g_axFrmTotalCyclesNoTail[f], f, t);
+}
+
+// ---------------------------------------------------------------------------
+//
+bool isLongTest(u8 uTest)
+{
+#if LONGTEST_ALL_TESTS==1
+    (void)uTest;
+    return true;
+#else
+    return uTest < CALIBRATION_TESTS || g_aoTest[uTest].bVDPPort;
+#endif
+}
+
+// ---------------------------------------------------------------------------
+//
+u8 getLongFrames(void)
+{
+    return isR800(g_eCPUMode) ? LONG_FRAMES_R800 : LONG_FRAMES;
+}
+
+// ---------------------------------------------------------------------------
+// Sum of the cycles of the long calibration tests, in the unrolled blocks and
+// the tails. Divide by CALIBRATION_TESTS (or multiply the rest)
+//
+u32 getLongCalibrationCycles(void)
+{
+    u8 uTail = getTailCycleCost();
+    u32 lCycles = 0;
+
+    for(u8 t = 0; t < CALIBRATION_TESTS; t++)
+        lCycles += g_alLongInstr[t] * getRealSingleCost(t) + (u32)g_auLongXtra[t] * uTail;
+
+    return lCycles;
+}
+
+// ---------------------------------------------------------------------------
+// The long tests all span the same amount of frames, so the sync tests give
+// the cycles spent in the unrolled blocks (+tails). Everything else (ISRs,
+// common start) is equal in all runs and cancels out. Quantisation is one
+// instruction over all the frames, which gives sub-cycle precision.
+//
+void calcLongStatistics(void)
+{
+    u8 uTail = getTailCycleCost();
+    u32 lCycles = getLongCalibrationCycles();
+
+    for(u8 t = 0; t < arraysize(g_aoTest); t++)
+        if(isLongTest(t))
+            g_axLongTestCost[t] = fixDiv(lCycles + CALIBRATION_TESTS * ((s16)getStartupCycleCost(0) - getStartupCycleCost(t) - (s16)g_auLongXtra[t] * uTail),
+                                         CALIBRATION_TESTS * g_alLongInstr[t]);
+}
+
+// ---------------------------------------------------------------------------
+// Runs the current test (setupTestInMemory) over many frames. customLongISR
+// lets the test run until the last frame, where customISR stores the PC-reg.
+//
+void runLongTest(u8 uTest)
+{
+    prepareVDP(g_aoTest[uTest].eReadVRAM);
+
+    halt();                                 // a full frame to set up in
+    g_uLongFramesLeft = getLongFrames() + 1;// +1 is the halt in commonStartForAllTests
+
+    commonStartForAllTests();
+
+    u8 uUnrollSingleInstrSize = g_aoTest[uTest].uUnrollSingleInstructionSize;
+    u8 uUnrollInstrSize = g_aoTest[uTest].uUnrollInstructionsSize;
+    u16 nMax = (u16)((u32)(0x4000 - SIZE_TAIL_BLOCK) / uUnrollInstrSize);
+    u32 lBlockInstructions = (u32)nMax * uUnrollInstrSize / uUnrollSingleInstrSize;
+
+    u16 nLength = (u16)g_pPCReg - (u16)&runTestAsmInMem;
+
+    g_alLongInstr[uTest] = g_uExtraRounds * lBlockInstructions + nLength / uUnrollSingleInstrSize;
+    g_auLongXtra[uTest] = g_uExtraRounds;
+}
+
+// ---------------------------------------------------------------------------
+// Long tests are run in 60 Hz only, as before. Custom ISR must be active.
+//
+void runAllLongTests(void)
+{
+    setPALRefreshRate(false);
+    halt();                 // halt here is needed on AX-370, otherwise we get skewed results
+
+    disableInterrupt();
+    g_pInterrupt = &customLongISR;
+    enableInterrupt();
+
+    for(u8 t = 0; t < arraysize(g_aoTest); t++)
+    {
+        if(!isLongTest(t))
+            continue;
+
+        setupTestInMemory(t);
+        runLongTest(t);
+        restoreVDPAfterTest();
+    }
+
+    disableInterrupt();
+    g_pInterrupt = &customISR;
+    enableInterrupt();
+}
+
+#if BLOCK_BENCH==1
+// ---------------------------------------------------------------------------
+// ld bc,uCount + ld hl,from (+ ld de,to) and the block instruction, into
+// g_auBlockPattern. otir/inir have the port in C and the count in B. cpir
+// has xor a instead of ld de. Without bInstr: the setup only. Returns the size
+//
+u8 buildBlockPattern(const BlockTest* pTest, u8 uCount, bool bInstr)
+{
+    u8* p = g_auBlockPattern;
+    u16 nFrom = pTest->eFrom == BLOCK_ROM ? 0x4000 : (u16)g_auBlockBuf;
+    u16 nTo = (u16)g_auBlockBuf + BLOCK_COUNT;
+
+    if(pTest->uOpcode == 0xB8)      // lddr, from the end
+    {
+        nFrom += BLOCK_COUNT - 1;
+        nTo += BLOCK_COUNT - 1;
+    }
+
+    *p++ = 0x01;                    // ld bc,nn
+
+    if(pTest->eFrom == BLOCK_VRAM || pTest->eTo == BLOCK_VRAM)
+    {
+        u16 nAddr = pTest->eFrom == BLOCK_VRAM ? nTo : nFrom;
+
+        *p++ = 0x98;
+        *p++ = uCount;
+        *p++ = 0x21;                // ld hl,nn
+        *p++ = (u8)nAddr;
+        *p++ = (u8)(nAddr >> 8);
+    }
+    else
+    {
+        *p++ = uCount;
+        *p++ = 0;
+        *p++ = 0x21;                // ld hl,nn
+        *p++ = (u8)nFrom;
+        *p++ = (u8)(nFrom >> 8);
+
+        if(pTest->eTo == BLOCK_NONE)
+        {
+            *p++ = 0xAF;            // xor a
+        }
+        else
+        {
+            *p++ = 0x11;            // ld de,nn
+            *p++ = (u8)nTo;
+            *p++ = (u8)(nTo >> 8);
+        }
+    }
+
+    if(bInstr)
+    {
+        *p++ = 0xED;
+        *p++ = pTest->uOpcode;
+    }
+
+    return (u8)(p - g_auBlockPattern);
+}
+
+// ---------------------------------------------------------------------------
+// Unrolls the pattern and runs it over the frames of the long tests, with
+// customLongISR. Returns the cycles per pattern, from the long calibration
+// tests, which have the same startup block. Page 2 must be RAM (ROM mode)
+//
+fix8 runBlockTest(const BlockTest* pTest, u8 uCount, bool bInstr)
+{
+    u8 uSize = buildBlockPattern(pTest, uCount, bInstr);
+    u16 nMax = (u16)((u32)(0x4000 - SIZE_TAIL_BLOCK) / uSize);
+    u8* p = (u8*)&runTestAsmInMem;
+
+    memcpy(p, g_auBlockPattern, uSize);
+    replicateUnroll(uSize, nMax * uSize);
+    memcpy(p + nMax * uSize, &TEST_TAIL, SIZE_TAIL_BLOCK);
+
+    prepareVDP(pTest->eFrom == BLOCK_VRAM ? YES : (pTest->eTo == BLOCK_VRAM ? NO : NA));
+
+    halt();                                 // a full frame to set up in
+    g_uLongFramesLeft = getLongFrames() + 1;// +1 is the halt in commonStartForAllTests
+
+    commonStartForAllTests();
+
+    u32 lPatterns = (u32)g_uExtraRounds * nMax + ((u16)g_pPCReg - (u16)p) / uSize;
+
+    return fixDiv(getLongCalibrationCycles() - (u32)CALIBRATION_TESTS * g_uExtraRounds * getTailCycleCost(),
+                  CALIBRATION_TESTS * lPatterns);
+}
+
+// ---------------------------------------------------------------------------
+// Every block test three times: the setup alone, with a count of 1 (the
+// final step only) and with BLOCK_COUNT (BLOCK_COUNT-1 repeat steps and the
+// final one). Must run after runAllLongTests. Custom ISR must be active.
+//
+void runBlockBench(void)
+{
+#ifdef ROM_OUTPUT_FILE
+    disableInterrupt();
+    memAPI_enaSltPg2_NI_fromC(g_uSlotidPage2RAM);
+    enableInterrupt();
+#endif
+
+    g_pFncCurStartupBlock = g_aoTest[0].pFncStartupBlock;  // as sync1, so it cancels out
+    memset(g_auBlockBuf, 0xFF, sizeof(g_auBlockBuf));
+
+    setPALRefreshRate(false);
+    halt();
+
+    disableInterrupt();
+    g_pInterrupt = &customLongISR;
+    enableInterrupt();
+
+    for(u8 t = 0; t < arraysize(g_aoBlockTest); t++)
+    {
+        fix8 xSetup = runBlockTest(&g_aoBlockTest[t], 1, false);
+        fix8 xOne = runBlockTest(&g_aoBlockTest[t], 1, true);
+        fix8 xMany = runBlockTest(&g_aoBlockTest[t], BLOCK_COUNT, true);
+
+        g_axBlockCost[t][0] = xSetup;
+        g_axBlockCost[t][1] = xOne - xSetup;
+        g_axBlockCost[t][2] = (xMany - xOne) / (BLOCK_COUNT - 1);
+
+        restoreVDPAfterTest();
+    }
+
+    disableInterrupt();
+    g_pInterrupt = &customISR;
+    enableInterrupt();
+}
+#endif
+
+#if OPCODE_SWEEP==1 || PORT_SWEEP==1
+// ---------------------------------------------------------------------------
+//
+bool isOpInSet(const u8* pSet, u8 uOp)
+{
+    return (pSet[uOp >> 3] >> (uOp & 7)) & 1;
+}
+
+// ---------------------------------------------------------------------------
+// Opcode sweep: the startup block points every register used for memory
+// access into g_auScratch. BC does both (bc) and (c), so it is the scratch
+// address whose low byte is SWEEP_PORT. IX is the start of the block, so
+// (ix-8) is the end of g_auScratch. A is 0 for the out of the port sweep.
+// ld hl/de/bc/iy + xor a + ret: 65 cycles (17 R800)
+//
+void buildSweepStartup(void)
+{
+    u16 nScratch = (u16)g_auScratch;
+    u16 anRegs[] = {nScratch + 0x20,                                    // ld hl,nn
+                    nScratch + 0x40,                                    // ld de,nn
+                    nScratch + (u8)(SWEEP_PORT - (u8)nScratch),         // ld bc,nn
+                    nScratch + 0x80 - (s8)SWEEP_DISP};                  // ld iy,nn
+    const u8 auLd[] = {0x21, 0x11, 0x01, 0x21};
+    u8* p = g_auSweepStartup;
+
+    for(u8 r = 0; r < 4; r++)
+    {
+        if(r == 3)
+            *p++ = 0xFD;
+
+        *p++ = auLd[r];
+        *p++ = (u8)anRegs[r];
+        *p++ = (u8)(anRegs[r] >> 8);
+    }
+
+    *p++ = 0xAF;    // xor a
+    *p = 0xC9;      // ret
+}
+#endif
+
+#if OPCODE_SWEEP==1
+// ---------------------------------------------------------------------------
+// Bytes of opcode uOp in table eTable, with operands, into g_auSweepInstr.
+// Returns the length, or 0 if the opcode can not be run unrolled. All nn are
+// in g_auScratch and all n are SWEEP_PORT (harmless for ld r,n and ALU too).
+//
+u8 buildSweepInstruction(enum sweep_table eTable, u8 uOp)
+{
+    u8* p = g_auSweepInstr;
+    u16 nAddr = (u16)g_auScratch + 0xA0;
+
+    if(eTable != SWEEP_BASE)
+        *p++ = g_auSweepPrefix[eTable];
+
+    if(eTable == SWEEP_CB)
+    {
+        *p++ = uOp;
+    }
+    else if(eTable >= SWEEP_DDCB)
+    {
+        *p++ = 0xCB;
+        *p++ = SWEEP_DISP;
+        *p++ = uOp;
+    }
+    else if(eTable == SWEEP_ED)
+    {
+        if(isOpInSet(g_auSweepExcludeED, uOp))
+            return 0;
+
+        *p++ = uOp;
+
+        if(isOpInSet(g_auSweepImmNNED, uOp))
+        {
+            *p++ = (u8)nAddr;
+            *p++ = (u8)(nAddr >> 8);
+        }
+    }
+    else    // base, DD and FD. DD/FD turn hl into ix/iy and (hl) into (ix+d)/(iy+d)
+    {
+        if(isOpInSet(g_auSweepExclude, uOp) || (eTable == SWEEP_DD && isOpInSet(g_auSweepWritesIX, uOp)))
+            return 0;
+
+        *p++ = uOp;
+
+        if(eTable != SWEEP_BASE && isOpInSet(g_auSweepMemHL, uOp))
+            *p++ = SWEEP_DISP;
+
+        if(isOpInSet(g_auSweepImmN, uOp))
+            *p++ = SWEEP_PORT;
+
+        if(isOpInSet(g_auSweepImmNN, uOp))
+        {
+            *p++ = (u8)nAddr;
+            *p++ = (u8)(nAddr >> 8);
+        }
+    }
+
+    return (u8)(p - g_auSweepInstr);
+}
+#endif
+
+#if OPCODE_SWEEP==1 || PORT_SWEEP==1
+// ---------------------------------------------------------------------------
+// Unrolls g_auSweepInstr and runs it NUM_ITERATIONS frames. Returns the
+// average instructions per frame, or the max (as for the calibration tests)
+//
+fix8 runSweepTest(u8 uSize, bool bMax)
+{
+    u16 nMax = (u16)((u32)(0x4000 - SIZE_TAIL_BLOCK) / uSize);
+    u8* p = (u8*)&runTestAsmInMem;
+
+    memcpy(p, g_auSweepInstr, uSize);
+    replicateUnroll(uSize, nMax * uSize);
+    memcpy(p + nMax * uSize, &TEST_TAIL, SIZE_TAIL_BLOCK);
+
+    u32 lTotal = 0;
+    u32 lMax = 0;
+
+    for(u8 i = 0; i < NUM_ITERATIONS; i++)
+    {
+        prepareVDP(NO);
+        commonStartKeepIY();    // FD-instructions may change IY
+
+        u32 n = getFrameInstructions(uSize, uSize);
+        lTotal += n;
+
+        if(n > lMax)
+            lMax = n;
+    }
+
+    return bMax ? toFix(lMax) : toFix(lTotal) / NUM_ITERATIONS;
+}
+
+// ---------------------------------------------------------------------------
+// Sets up the sweep startup block and returns the cycles in a frame at 60 Hz,
+// from cpl and inc hl (as the sync tests) run with that same startup block, so
+// the startup cost cancels out. Custom ISR must be active.
+//
+fix8 calibrateSweep(void)
+{
+    setPALRefreshRate(false);
+    halt();
+
+    buildSweepStartup();
+    g_pFncCurStartupBlock = (function*)g_auSweepStartup;
+
+    g_auSweepInstr[0] = 0x2F;   // cpl, as sync1
+    fix8 xFrameCycles = (runSweepTest(1, true) + FRAME_COUNT_ADD_UP) * getRealSingleCost(0);
+    g_auSweepInstr[0] = 0x23;   // inc hl, as sync2
+    return (xFrameCycles + (runSweepTest(1, true) + FRAME_COUNT_ADD_UP) * getRealSingleCost(1)) / 2;
+}
+
+// ---------------------------------------------------------------------------
+// In 1/100 cycles, of the instruction in g_auSweepInstr
+//
+u16 getSweepCost(fix8 xFrameCycles, u8 uSize)
+{
+    return (u16)(((u32)fixDiv(xFrameCycles, runSweepTest(uSize, false)) * 100 + 128) >> FIX_SHIFT);
+}
+#endif
+
+#if OPCODE_SWEEP==1
+
+// ---------------------------------------------------------------------------
+// Every opcode of every table, at 60 Hz, with the sweep's own calibration.
+// Custom ISR must be active.
+//
+void runOpcodeSweep(void)
+{
+    fix8 xFrameCycles = calibrateSweep();
+
+    for(enum sweep_table e = 0; e < SWEEP_TABLE_COUNT; e++)
+    {
+        u8 uOp = 0;
+        do
+        {
+            u8 uSize = buildSweepInstruction(e, uOp);
+
+            if(uSize == 0)
+                g_anSweepCost[e][uOp] = SWEEP_NOT_RUN;
+            else
+                g_anSweepCost[e][uOp] = getSweepCost(xFrameCycles, uSize);
+        }
+        while(++uOp != 0);
+    }
+}
+#endif
+
+#if PORT_SWEEP==1
+// ---------------------------------------------------------------------------
+// in a,(n) and out (n),a on every port, at 60 Hz. Shows the I/O wait states
+// of the machine (the S1990 on turbo R, the VDP ports everywhere) and which
+// ports are decoded at all. VRAM is set up as in out98, the palette is
+// restored after. Custom ISR must be active.
+//
+void runPortSweep(void)
+{
+    fix8 xFrameCycles = calibrateSweep();
+    const u8* apExclude[] = {g_auPortExcludeIn, g_auPortExcludeOut};
+
+    for(u8 d = 0; d < 2; d++)
+    {
+        u8 uPort = 0;
+        do
+        {
+            if(isOpInSet(apExclude[d], uPort))
+            {
+                g_anPortCost[d][uPort] = SWEEP_NOT_RUN;
+            }
+            else
+            {
+                g_auSweepInstr[0] = d == 0 ? 0xDB : 0xD3;   // in a,(n) / out (n),a
+                g_auSweepInstr[1] = uPort;
+                g_anPortCost[d][uPort] = getSweepCost(xFrameCycles, 2);
+            }
+        }
+        while(++uPort != 0);
+    }
+
+    restoreVDPAfterTest();
+}
+#endif
+
+#if MEMORY_ATLAS==1
+// ---------------------------------------------------------------------------
+// Memory atlas: the startup block points IX to the block (jp (ix) in
+// commonStartForAllTests and in the tail) and HL to the data.
+// ld ix,nn + ld hl,nn + ret
+//
+void buildAtlasStartup(u16 nBlock, u16 nData)
+{
+    u8* p = g_auAtlasStartup;
+
+    *p++ = 0xDD;
+    *p++ = 0x21;            // ld ix,nBlock
+    *p++ = (u8)nBlock;
+    *p++ = (u8)(nBlock >> 8);
+    *p++ = 0x21;            // ld hl,nData
+    *p++ = (u8)nData;
+    *p++ = (u8)(nData >> 8);
+    *p = 0xC9;              // ret
+}
+
+// ---------------------------------------------------------------------------
+// nSize bytes of the single byte instruction uOp at pBlock, with the tail last
+//
+void buildAtlasBlock(u8* pBlock, u16 nSize, u8 uOp)
+{
+    memset(pBlock, uOp, nSize - SIZE_TAIL_BLOCK);
+    memcpy(pBlock + nSize - SIZE_TAIL_BLOCK, &TEST_TAIL, SIZE_TAIL_BLOCK);
+}
+
+// ---------------------------------------------------------------------------
+// Runs the block at pBlock NUM_ITERATIONS frames, HL at nData. Returns the
+// average instructions per frame, or the max (as for the calibration tests).
+// The extra rounds are counted as in getFrameInstructions. With nData in
+// page 0 or 1, the frames are run through atlasPageRun (g_auAtlasSwitch)
+//
+fix8 runAtlasTest(u8* pBlock, u16 nSize, u16 nData, bool bMax)
+{
+    buildAtlasStartup((u16)pBlock, nData);
+    g_pFncCurStartupBlock = (function*)g_auAtlasStartup;
+
+    u32 lTotal = 0;
+    u32 lMax = 0;
+
+    for(u8 i = 0; i < NUM_ITERATIONS; i++)
+    {
+        if(nData < 0x8000)
+            ((void (*)(void))ATLAS_PAGE_RUN)();
+        else
+            commonStartForAllTests();
+
+        u32 n = (u16)g_pPCReg - (u16)pBlock + (u32)g_uExtraRounds * nSize;
+        lTotal += n;
+
+        if(n > lMax)
+            lMax = n;
+    }
+
+    return bMax ? toFix(lMax) : toFix(lTotal) / NUM_ITERATIONS;
+}
+
+// ---------------------------------------------------------------------------
+// Writes to 0x8000 and reads it back
+//
+bool isPage2RAMNI(void)
+{
+    volatile u8* p = (volatile u8*)0x8000;
+    u8 u = *p;
+
+    *p = ~u;
+    bool bRAM = *p == (u8)~u;
+    *p = u;
+
+    return bRAM;
+}
+
+// ---------------------------------------------------------------------------
+// Segments of the mapper in page 2. Every segment gets its number in byte 0,
+// counting up, so segment 0 ends up with 256 - segments. 1 if there is no
+// mapper. Segment 0 is page 3, byte 0 is restored in all of them.
+//
+u16 getMapperSegmentsNI(void)
+{
+    volatile u8* p = (volatile u8*)0x8000;
+    u16 s;
+
+    for(s = 0; s < 256; s++)
+    {
+        memAPI_setMapperPg2_NI_fromC((u8)s);
+        g_auAtlasSave[s] = *p;
+    }
+
+    for(s = 0; s < 256; s++)
+    {
+        memAPI_setMapperPg2_NI_fromC((u8)s);
+        *p = (u8)s;
+    }
+
+    memAPI_setMapperPg2_NI_fromC(0);
+    u16 nSegments = 256 - *p;
+
+    for(s = 256; s-- != 0;)     // down, so the first save of a segment is the last one written
+    {
+        memAPI_setMapperPg2_NI_fromC((u8)s);
+        *p = g_auAtlasSave[s];
+    }
+
+    return nSegments;
+}
+
+// ---------------------------------------------------------------------------
+// If the segment in page 2 is also in page 0 or 3 (in use, not to be written)
+//
+bool isSegmentInUseNI(void)
+{
+    volatile u8* p2 = (volatile u8*)0x8100;
+    volatile u8* p0 = (volatile u8*)0x0100;
+    volatile u8* p3 = (volatile u8*)0xC100;
+    u8 u0 = *p0;
+    u8 u3 = *p3;
+    u8 u = *p2;
+
+    *p2 = ~u;
+    bool bInUse = *p0 != u0 || *p3 != u3;
+    *p2 = u;
+
+    return bInUse;
+}
+
+// ---------------------------------------------------------------------------
+// Cycles per instruction, in 1/100 cycles
+//
+u16 getAtlasCost(fix8 xFrameCycles, fix8 xInstructions)
+{
+    return (u16)(((u32)fixDiv(xFrameCycles, xInstructions) * 100 + 128) >> FIX_SHIFT);
+}
+
+// ---------------------------------------------------------------------------
+// M1: nop in page 2 (the block must be there). Read and write: ld a,(hl) and
+// ld (hl),a in page 0, HL in page 2. In 1/100 cycles
+//
+u16 runAtlasAccess(enum atlas_access eAccess, fix8 xFrameCycles)
+{
+    fix8 xInstructions;
+
+    if(eAccess == ATLAS_FETCH)
+        xInstructions = runAtlasTest((u8*)&runTestAsmInMem, 0x4000, 0x8000, false);
+    else if(eAccess == ATLAS_READ)
+        xInstructions = runAtlasTest((u8*)ATLAS_READ_BLOCK, ATLAS_READ_SIZE, 0x8000, false);
+    else
+        xInstructions = runAtlasTest((u8*)ATLAS_WRITE_BLOCK, ATLAS_WRITE_SIZE, 0x8000, false);
+
+    return getAtlasCost(xFrameCycles, xInstructions);
+}
+
+// ---------------------------------------------------------------------------
+//
+void addAtlasCost(u16* pnMinMax, u16 nCost)
+{
+    if(pnMinMax[0] == ATLAS_NOT_RUN || nCost < pnMinMax[0])
+        pnMinMax[0] = nCost;
+
+    if(pnMinMax[1] == ATLAS_NOT_RUN || nCost > pnMinMax[1])
+        pnMinMax[1] = nCost;
+}
+
+// ---------------------------------------------------------------------------
+// One slot in page 2, all of its mapper segments. Code and data are apart:
+// the read is run from page 0, always. The M1 and write tests are run on RAM
+// only, and not on segments in use in page 0 or 3. Nor on the last 4
+// segments of internal RAM in R800 DRAM mode, which hold the BIOS. Our own
+// ROM has a segment with inc a for the M1 test.
+//
+void runAtlasSlot(u8 uIndex, u8 uSlotID, fix8 xFrameCycles)
+{
+    u8* pFetch = (u8*)&runTestAsmInMem;   // 0x8000, page 2
+    u16 nSegments = 0;
+
+    disableInterrupt();
+    memAPI_enaSltPg2_NI_fromC(uSlotID);
+    if(isPage2RAMNI())
+        nSegments = getMapperSegmentsNI();
+    enableInterrupt();
+
+    g_auAtlasSlotID[uIndex] = uSlotID;
+    g_anAtlasSegments[uIndex] = nSegments;
+    memset(g_anAtlasCost[uIndex], 0xFF, sizeof(g_anAtlasCost[uIndex]));   // ATLAS_NOT_RUN
+
+    u16 s = 0;
+    do
+    {
+        bool bWritable = false;
+
+        if(nSegments != 0)
+        {
+            disableInterrupt();
+            memAPI_setMapperPg2_NI_fromC((u8)s);
+            bWritable = !isSegmentInUseNI();
+            enableInterrupt();
+
+            if(g_eCPUMode == R800_DRAM && uSlotID == g_uSlotidPage2RAM && s + 4 >= nSegments)
+                bWritable = false;
+        }
+
+        if(bWritable)
+        {
+            buildAtlasBlock(pFetch, 0x4000, 0x00);  // nop
+            addAtlasCost(g_anAtlasCost[uIndex][ATLAS_FETCH], runAtlasAccess(ATLAS_FETCH, xFrameCycles));
+            addAtlasCost(g_anAtlasCost[uIndex][ATLAS_WRITE], runAtlasAccess(ATLAS_WRITE, xFrameCycles));
+        }
+        else if(uSlotID == g_uSlotidPage2ROM)
+        {
+            ENABLE_SEGMENT_PAGE2(ATLAS_ROM_FETCH_SEG);
+            addAtlasCost(g_anAtlasCost[uIndex][ATLAS_FETCH], runAtlasAccess(ATLAS_FETCH, xFrameCycles));
+        }
+
+        addAtlasCost(g_anAtlasCost[uIndex][ATLAS_READ], runAtlasAccess(ATLAS_READ, xFrameCycles));
+    }
+    while(++s < nSegments);
+}
+
+// ---------------------------------------------------------------------------
+// Reads in page 0 and 1 of one slot (main ROM, SUB-ROM, disk ROM..): ld a,(hl)
+// in page 2, HL at the start of the page. Page 0 only with IM 2, with IM 1
+// the ISR is reached through 0x0038. The block and atlasPageRun must be in
+// page 2 RAM. In 1/100 cycles
+//
+void runAtlasPages(u8 uIndex, u8 uSlotID, fix8 xFrameCycles)
+{
+    u8 uPrim = uSlotID & 0x03;
+
+    g_anAtlasPageRead[uIndex][0] = ATLAS_NOT_RUN;
+    g_auAtlasSwitch[3] = (uSlotID & 0x80) ? uPrim << 6 : 0xFF;
+
+    for(u8 uPage = USE_IM2 == 1 ? 0 : 1; uPage < 2; uPage++)
+    {
+        u8 uShift = uPage * 2;
+
+        g_auAtlasSwitch[0] = uPrim << uShift;
+        g_auAtlasSwitch[1] = 0x03 << uShift;
+        g_auAtlasSwitch[2] = ((uSlotID >> 2) & 0x03) << uShift;
+
+        fix8 xInstructions = runAtlasTest((u8*)&runTestAsmInMem, ATLAS_PAGE_READ_SIZE, (u16)uPage << 14, false);
+        g_anAtlasPageRead[uIndex][uPage] = getAtlasCost(xFrameCycles, xInstructions);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Every slot and subslot in page 2, and then the reads in page 0 and 1 of
+// them, at 60 Hz. Calibration as the opcode sweep (cpl and inc hl, with the
+// same startup block), and the baseline of every access, in internal RAM. Custom ISR must be active. Page 0 is RAM
+// then with IM 1, and is switched to RAM here with IM 2.
+//
+void runMemoryAtlas(void)
+{
+    u8* pFetch = (u8*)&runTestAsmInMem;
+
+    setPALRefreshRate(false);
+    halt();
+
+    disableInterrupt();
+#if USE_IM2==1
+    memAPI_enaSltPg0_NI_fromC(g_uSlotidPage0RAM);       // as with IM 1
+#endif
+    memAPI_enaSltPg2_NI_fromC(g_uSlotidPage2RAM);
+    memAPI_setMapperPg2_NI_fromC(ATLAS_MAPPER_SEG);
+    enableInterrupt();
+
+    buildAtlasBlock(pFetch, 0x4000, 0x2F);              // cpl, as sync1
+    fix8 xFrameCycles = (runAtlasTest(pFetch, 0x4000, 0x8000, true) + FRAME_COUNT_ADD_UP) * getRealSingleCost(0);
+    buildAtlasBlock(pFetch, 0x4000, 0x23);              // inc hl, as sync2
+    xFrameCycles = (xFrameCycles + (runAtlasTest(pFetch, 0x4000, 0x8000, true) + FRAME_COUNT_ADD_UP) * getRealSingleCost(1)) / 2;
+
+    buildAtlasBlock((u8*)ATLAS_READ_BLOCK, ATLAS_READ_SIZE, 0x7E);     // ld a,(hl)
+    buildAtlasBlock((u8*)ATLAS_WRITE_BLOCK, ATLAS_WRITE_SIZE, 0x77);   // ld (hl),a
+    buildAtlasBlock(pFetch, 0x4000, 0x00);                              // nop
+
+    for(enum atlas_access e = 0; e < ATLAS_ACCESS_COUNT; e++)
+        g_anAtlasBase[e] = runAtlasAccess(e, xFrameCycles);
+
+    g_uAtlasSlots = 0;
+    for(u8 uPrim = 0; uPrim < 4; uPrim++)
+    {
+        bool bExpanded = (g_auBIOS_EXPTBL[uPrim] & 0x80) != 0;
+
+        for(u8 uSub = 0; uSub < (bExpanded ? 4 : 1); uSub++)
+            runAtlasSlot(g_uAtlasSlots++, bExpanded ? 0x80 | (uSub << 2) | uPrim : uPrim, xFrameCycles);
+    }
+
+    disableInterrupt();
+    memAPI_enaSltPg2_NI_fromC(g_uSlotidPage2RAM);
+    memAPI_setMapperPg2_NI_fromC(ATLAS_MAPPER_SEG);
+    enableInterrupt();
+
+    buildAtlasBlock(pFetch, ATLAS_PAGE_READ_SIZE, 0x7E);                 // ld a,(hl)
+    memcpy((u8*)ATLAS_PAGE_RUN, (u8*)&atlasPageRun, (u16)&atlasPageRunEnd - (u16)&atlasPageRun);
+
+    for(u8 i = 0; i < g_uAtlasSlots; i++)
+        runAtlasPages(i, g_auAtlasSlotID[i], xFrameCycles);
+
+    disableInterrupt();
+#if USE_IM2==1
+    memAPI_enaSltPg0_NI_fromC(g_uSlotidPage0BIOS);
+#endif
+    memAPI_enaSltPg2_NI_fromC(g_uSlotidPage2RAM);
+    memAPI_setMapperPg2_NI_fromC(ATLAS_MAPPER_SEG);
+    enableInterrupt();
+}
+#endif
+
+#if VRAM_MATRIX==1 || CMD_CONTENTION==1 || V9958_WTE==1
+// ---------------------------------------------------------------------------
+// The calibration tests and the VDP tests at 60 Hz, as they are set up now
+// (screen mode, sprites, command engine...). Custom ISR must be active. The
+// costs of the VDP tests go to pxCost, in test order
+//
+void runVDPTestsNTSC(fix8* pxCost)
+{
+    for(u8 t = 0; t < arraysize(g_aoTest); t++)
+    {
+        if(t < CALIBRATION_TESTS || g_aoTest[t].bVDPPort)
+        {
+            setupTestInMemory(t);
+            runAdaptiveIterations(NTSC, t);
+        }
+    }
+
+    fix8 xFrmCyclesNoTail = getFrameCyclesNoTail(NTSC);
+    u8 i = 0;
+
+    for(u8 t = 0; t < arraysize(g_aoTest) && i < MATRIX_MAX_TESTS; t++)
+        if(g_aoTest[t].bVDPPort)
+            pxCost[i++] = getTestCost(xFrmCyclesNoTail, NTSC, t);
+}
+#endif
+
+#if VRAM_MATRIX==1
+// ---------------------------------------------------------------------------
+// The CPU access slots of the VDP depend on the screen mode, on sprites
+// (R#8 SPD) and on the display being on (R#1 BL). The calibration tests and
+// the VDP tests are run for every combination, at 60 Hz, with the VBLANK
+// timebase also on turbo R. Mode changes are done by the BIOS, hence the
+// original ISR in between. Must run before runAllIterations, as the results
+// of that one are overwritten here.
+//
+void runVRAMMatrix(void)
+{
+    u8 uRG8Org = g_uBIOS_RG8SAV;
+    bool bPALOrg = getPALRefreshRate();
+
+    initPalette();
+
+    for(u8 m = 0; m < arraysize(g_auMatrixModes); m++)
+    {
+        u8 uMode = g_auMatrixModes[m];
+
+        if(uMode >= 7 && (g_uBIOS_MODE & 0x06) != 0x04)
+            continue;                                   // less than 128kB VRAM
+
+        changeMode(uMode);
+
+        for(u8 v = 0; v < MATRIX_VARIANTS; v++)
+        {
+            if(uMode == 0 && !(v & 1))
+                continue;                               // no sprites in text modes
+
+            setSpritesAndDisplay(v);
+            setCustomISR();
+            setPALRefreshRate(false);
+            halt();
+
+            runVDPTestsNTSC(g_axMatrixCost[m][v]);
+
+            restoreOriginalISR();
+        }
+    }
+
+    disableInterrupt();
+    g_uBIOS_RG8SAV = uRG8Org;
+    writeVDPRegNI(uRG8Org, 8);
+    enableInterrupt();
+
+    changeMode(0);  // width from LINL40, as before. Display on
+    setPALRefreshRate(bPALOrg);
+    restorePalette();
+}
+#endif
+
+#if CMD_CONTENTION==1 || V9958_WTE==1
+// ---------------------------------------------------------------------------
+// The VDP tests in SCREEN 5 (the command engine needs a bitmap mode), first
+// idle and then with a HMMV running (runIteration). The command is started
+// before the frame rather than in the startup blocks, to keep their cycle
+// counts as they are. CPU VRAM access is in the upper 64kB, as usual.
+// SCREEN 5 and the custom ISR must be set up.
+//
+void runIdleAndBusy(fix8 axCost[2][MATRIX_MAX_TESTS])
+{
+    for(u8 l = 0; l < 2; l++)
+    {
+        g_bCmdLoad = (bool)l;
+        runVDPTestsNTSC(axCost[l]);
+    }
+
+    g_bCmdLoad = false;
+
+    disableInterrupt();
+    writeVDPRegNI(0, 46);   // STOP, the last command is still running
+    enableInterrupt();
+}
+#endif
+
+#if CMD_CONTENTION==1
+// ---------------------------------------------------------------------------
+//
+void runCommandContention(void)
+{
+    bool bPALOrg = getPALRefreshRate();
+
+    changeMode(5);
+
+    setCustomISR();
+    setPALRefreshRate(false);
+    halt();
+
+    runIdleAndBusy(g_axContentionCost);
+
+    restoreOriginalISR();
+
+    changeMode(0);
+    setPALRefreshRate(bPALOrg);
+}
+#endif
+
+#if V9958_WTE==1
+// ---------------------------------------------------------------------------
+// With WTE, the V9958 holds the CPU (WAIT) instead of dropping an access
+// that comes too early. Idle and busy, with WTE off and on.
+//
+void runWaitMode(void)
+{
+    g_bWaitRun = getVDPID() == 2;   // 0: V9938, 2: V9958
+
+    if(!g_bWaitRun)
+        return;
+
+    bool bPALOrg = getPALRefreshRate();
+
+    changeMode(5);
+
+    setCustomISR();
+    setPALRefreshRate(false);
+    halt();
+
+    for(u8 w = 0; w < 2; w++)
+    {
+        disableInterrupt();
+        writeVDPRegNI(w ? (g_uBIOS_RG25SAV | 0x04) : (g_uBIOS_RG25SAV & ~0x04), 25);
+        enableInterrupt();
+
+        runIdleAndBusy(g_axWaitCost[w]);
+    }
+
+    disableInterrupt();
+    writeVDPRegNI(g_uBIOS_RG25SAV, 25);
+    enableInterrupt();
+
+    restoreOriginalISR();
+
+    changeMode(0);
+    setPALRefreshRate(bPALOrg);
+}
+#endif
+
+#if VDP_CMD_BENCH==1
+// ---------------------------------------------------------------------------
+// Command engine throughput. The engine runs on its own, so the CPU just
+// polls S#2 (runVDPCommandNI) and counts completed commands over
+// VDPCMD_FRAMES frames, instead of storing the PC-reg. Both areas are in
+// page 1 (y 256-511), not visible. YMMM always runs to the right border,
+// hence DX = width - NX for all commands.
+//
+void runVDPCommandBench(void)
+{
+    u8 uRG8Org = g_uBIOS_RG8SAV;
+    bool bPALOrg = getPALRefreshRate();
+
+    for(u8 m = 0; m < arraysize(g_auCmdModes); m++)
+    {
+        if(g_auCmdModes[m] >= 7 && (g_uBIOS_MODE & 0x06) != 0x04)
+            continue;                                   // less than 128kB VRAM
+
+        changeMode(g_auCmdModes[m]);
+        setPALRefreshRate(false);
+
+        u16 nX = g_anCmdModeWidth[m] - VDPCMD_NX;
+
+        g_auVDPCmd[0]  = (u8)nX;                        // SX
+        g_auVDPCmd[1]  = nX >> 8;
+        g_auVDPCmd[2]  = (u8)(256 + VDPCMD_NY);         // SY
+        g_auVDPCmd[3]  = (256 + VDPCMD_NY) >> 8;
+        g_auVDPCmd[4]  = (u8)nX;                        // DX
+        g_auVDPCmd[5]  = nX >> 8;
+        g_auVDPCmd[6]  = 0;                             // DY = 256
+        g_auVDPCmd[7]  = 1;
+        g_auVDPCmd[8]  = (u8)VDPCMD_NX;                 // NX
+        g_auVDPCmd[9]  = VDPCMD_NX >> 8;
+        g_auVDPCmd[10] = (u8)VDPCMD_NY;                 // NY
+        g_auVDPCmd[11] = VDPCMD_NY >> 8;
+        g_auVDPCmd[12] = 0x55;                          // CLR, for the fills
+        g_auVDPCmd[13] = 0;                             // ARG: right, down, VRAM
+
+        for(u8 v = 0; v < MATRIX_VARIANTS; v++)
+        {
+            setSpritesAndDisplay(v);
+
+            for(u8 c = 0; c < arraysize(g_auCmdCodes); c++)
+            {
+                g_auVDPCmd[14] = g_auCmdCodes[c];
+
+                disableInterrupt();
+                u16 nCommands = runVDPCommandNI(VDPCMD_FRAMES, g_auVDPCmd);
+                enableInterrupt();
+
+                g_alCmdPixels[m][v][c] = (u32)nCommands * VDPCMD_NX * VDPCMD_NY / VDPCMD_FRAMES;
+            }
+        }
+    }
+
+    disableInterrupt();
+    g_uBIOS_RG8SAV = uRG8Org;
+    writeVDPRegNI(uRG8Org, 8);
+    enableInterrupt();
+
+    changeMode(0);
+    setPALRefreshRate(bPALOrg);
+}
+#endif
+
+#if SELF_CALIBRATION==1
+// ---------------------------------------------------------------------------
+// _customISR with CALIB_PAD_READS or no reads of S#0 first. Built in RAM as the
+// ISR code in UPPER has no room for it. Interrupts must be disabled
+//
+void buildPadISR(u8 uReads)
+{
+    u8* p = g_auPadISR;
+
+    *p++ = 0xF5;                // push af
+    *p++ = 0xAF;                // xor a
+    *p++ = 0xD3; *p++ = 0x99;   // out (0x99),a
+    *p++ = 0x3E; *p++ = 0x8F;   // ld a,0x8F
+    *p++ = 0xD3; *p++ = 0x99;   // out (0x99),a
+    *p++ = 0x00;                // nop
+
+    for(u8 i = 0; i < uReads; i++)
+    {
+        *p++ = 0xDB;            // in a,(0x99)
+        *p++ = 0x99;
+    }
+
+    *p++ = 0xF1;                // pop af
+    *p++ = 0xC3;                // jp _customISR
+    *p++ = (u8)(u16)&customISR;
+    *p = (u8)((u16)&customISR >> 8);
+
+    g_pInterrupt = g_auPadISR;
+}
+
+// ---------------------------------------------------------------------------
+// sync1 (one byte) unrolled in nSize bytes, tail included. Returns the
+// instructions in one round
+//
+u16 buildCalibrationBlock(u16 nSize)
+{
+    u16 nMax = nSize - SIZE_TAIL_BLOCK;
+    u8* p = (u8*)&runTestAsmInMem;
+
+    memcpy(p, *g_aoTest[0].pFncUnrollInstruction, 1);
+    replicateUnroll(1, nMax);
+    memcpy(p + nMax, &TEST_TAIL, SIZE_TAIL_BLOCK);
+
+    return nMax;
+}
+
+// ---------------------------------------------------------------------------
+// Average instructions per frame over NUM_ITERATIONS, counted exactly (nRound
+// per extra round). Average extra rounds in pxXtra
+//
+fix8 runCalibrationFrames(u16 nRound, fix8* pxXtra)
+{
+    u32 lTotal = 0;
+    u16 nXtra = 0;
+
+    for(u8 i = 0; i < NUM_ITERATIONS; i++)
+    {
+        prepareVDP(NO);
+        commonStartForAllTests();
+
+        lTotal += ((u16)g_pPCReg - (u16)&runTestAsmInMem) + (u32)g_uExtraRounds * nRound;
+        nXtra += g_uExtraRounds;
+    }
+
+    *pxXtra = toFix(nXtra) / NUM_ITERATIONS;
+    return toFix(lTotal) / NUM_ITERATIONS;
+}
+
+// ---------------------------------------------------------------------------
+// Finds what was assumed in the FRAME_CYCLES_ constants, from sync1 at 60 Hz:
+// A) The tail: the same frame with the full block and a short one. The short
+//    one has many more tails, at the cost of instructions.
+// B) The VDP I/O wait: the full block with CALIB_PAD_READS more VDP reads in
+//    the ISR. What the reads take beyond CALIB_IN_CYCLES is the wait.
+// The frame count add-up is found from the sync tests later on (see
+// getFrameCyclesNoTail). Custom ISR must be active.
+//
+void runSelfCalibration(void)
+{
+    setPALRefreshRate(false);
+    halt();
+
+    setupTestInMemory(0);       // RAM in page 2, and the startup block of sync1
+
+    disableInterrupt();
+    buildPadISR(0);             // A) and B) have the same ISR, apart from the reads
+    enableInterrupt();
+
+    u8 uCost = getRealSingleCost(0);
+    fix8 xXtraFull, xXtraShort, xXtraPad;
+
+    fix8 xInstrFull = runCalibrationFrames(buildCalibrationBlock(0x4000), &xXtraFull);
+    fix8 xInstrShort = runCalibrationFrames(buildCalibrationBlock(isR800(g_eCPUMode) ? CALIB_TAIL_BLOCK_R800 : CALIB_TAIL_BLOCK), &xXtraShort);
+
+    disableInterrupt();
+    buildPadISR(CALIB_PAD_READS);
+    enableInterrupt();
+
+    fix8 xInstrPad = runCalibrationFrames(buildCalibrationBlock(0x4000), &xXtraPad);
+
+    disableInterrupt();
+    g_pInterrupt = &customISR;
+    enableInterrupt();
+
+    if(xXtraShort <= xXtraFull || xInstrShort >= xInstrFull)
+        return;                 // something is off, keep the assumed values
+
+    g_xTailCycles = fixDiv((xInstrFull - xInstrShort) * uCost, xXtraShort - xXtraFull);
+
+    fix8 xPadCycles = (xInstrFull - xInstrPad) * uCost + (((xXtraFull - xXtraPad) * g_xTailCycles) >> FIX_SHIFT);
+    g_xVDPIOWait = xPadCycles / CALIB_PAD_READS - toFix(isR800(g_eCPUMode) ? CALIB_IN_CYCLES_R800 : CALIB_IN_CYCLES);
+
+    if(g_xVDPIOWait < 0)
+        g_xVDPIOWait = 0;       // quantisation
+
+    g_bSelfCalibrated = true;
+}
+#endif
+
+#if VERNIER==1
+// ---------------------------------------------------------------------------
+// Sync test uTest, with the startup block delayed by uSteps of the unroll
+// instruction of the other sync test. Returns the max frame cycles over
+// NUM_ITERATIONS, in the instructions and the tails. The extra rounds are
+// counted exactly (as runCalibrationFrames), one instruction off would be
+// more than the whole vernier
+//
+u32 runVernierStep(u8 uTest, u8 uSteps)
+{
+    const TestDescriptor* pOther = &g_aoTest[1 - uTest];
+    u8* p = g_auVernierStartup;
+
+    for(u8 i = 0; i < uSteps; i++)
+    {
+        memcpy(p, *pOther->pFncUnrollInstruction, pOther->uUnrollInstructionsSize);
+        p += pOther->uUnrollInstructionsSize;
+    }
+
+    *p = 0xC9;                  // ret, as TEST_EMPTY
+    g_pFncCurStartupBlock = (function*)g_auVernierStartup;
+
+    u8 uSize = g_aoTest[uTest].uUnrollInstructionsSize;
+    u8 uSingle = g_aoTest[uTest].uUnrollSingleInstructionSize;
+    u8 uCost = getRealSingleCost(uTest);
+    u32 lRound = (u32)((0x4000 - SIZE_TAIL_BLOCK) / uSize) * (uSize / uSingle) * uCost + getTailCycleCost();
+    u32 lMax = 0;
+
+    for(u8 i = 0; i < NUM_ITERATIONS; i++)
+    {
+        prepareVDP(NO);
+        commonStartForAllTests();
+
+        u32 n = (u32)(((u16)g_pPCReg - (u16)&runTestAsmInMem) / uSingle) * uCost + g_uExtraRounds * lRound;
+
+        if(n > lMax)
+            lMax = n;
+    }
+
+    return lMax;
+}
+
+// ---------------------------------------------------------------------------
+// Frame cycles in the unrolled block, to the cycle. Each run only tells that
+// the interrupt hits within one instruction (5 or 7 cycles). The sync tests
+// are run with the start delayed by 0, 7, 14.. cycles (sync1) and 0, 5, 10..
+// (sync2), which as 5 and 7 have no common divisor puts the interrupt in
+// every cycle of that instruction. The ranges have one cycle in common.
+// The range is in frame cycles, tails included. Z80 only, the R800 runs both sync tests at 1 cycle already. Custom ISR must
+// be active.
+//
+void runVernier(void)
+{
+    memset(g_alVernierLow, 0, sizeof(g_alVernierLow));
+    memset(g_alVernierHigh, 0, sizeof(g_alVernierHigh));
+
+    if(isR800(g_eCPUMode) || g_eTimebase == TIMEBASE_S1990)
+        return;
+
+    for(enum freq_variant f = 0; f < FREQ_COUNT; f++)
+    {
+        setPALRefreshRate((bool)f);
+        halt();
+
+        u32 lLow = 0;
+        u32 lHigh = (u32)-1;
+
+        for(u8 t = 0; t < CALIBRATION_TESTS; t++)
+        {
+            setupTestInMemory(t);
+
+            u8 uCost = getRealSingleCost(t);
+            u8 uDelay = getRealSingleCost(1 - t);
+
+            for(u8 k = 0; k < uCost && k < sizeof(g_auVernierStartup) - 1; k++)
+            {
+                u32 lAt = runVernierStep(t, k) + (u16)k * uDelay;
+
+                if(lAt > lLow)
+                    lLow = lAt;
+
+                if(lAt + uCost < lHigh)
+                    lHigh = lAt + uCost;
+            }
+        }
+
+        if(lHigh > lLow)
+        {
+            g_alVernierLow[f] = lLow;
+            g_alVernierHigh[f] = lHigh;
+        }
+    }
+}
+#endif
+
+#if JITTER==1
+// ---------------------------------------------------------------------------
+// The sync tests, JITTER_FRAMES frames in a row. customJitterISR stores the
+// position in the block at every VBLANK, in one run. Each frame is the
+// instructions and the tails run in it, in cycles, stored as the change from
+// the frame before. Custom ISR must be active.
+//
+void runJitter(void)
+{
+    setPALRefreshRate(false);
+    halt();
+
+    disableInterrupt();
+    g_pInterrupt = &customJitterISR;
+    enableInterrupt();
+
+    for(u8 t = 0; t < CALIBRATION_TESTS; t++)
+    {
+        setupTestInMemory(t);
+        g_auJitterClipped[t] = 0;
+
+        disableInterrupt();
+        g_pJitterNext = g_auJitterSamples;
+        g_pJitterEnd = g_auJitterSamples + sizeof(g_auJitterSamples);
+        enableInterrupt();
+
+        prepareVDP(NO);
+        commonStartForAllTests();
+
+        u8 uSize = g_aoTest[t].uUnrollInstructionsSize;
+        u8 uSingle = g_aoTest[t].uUnrollSingleInstructionSize;
+        u8 uCost = getRealSingleCost(t);
+        u8 uTail = getTailCycleCost();
+        u32 lRound = (u32)((0x4000 - SIZE_TAIL_BLOCK) / uSize) * (uSize / uSingle) * uCost + uTail;   // as runVernierStep
+        u8* p = g_auJitterSamples;
+        u32 lPrev = 0;
+
+        for(u16 n = 0; n < JITTER_FRAMES; n++, p += 3)
+        {
+            u16 nFrom = (*(u16*)p - (u16)&runTestAsmInMem) / uSingle;
+            u16 nTo = (*(u16*)(p + 3) - (u16)&runTestAsmInMem) / uSingle;
+            u32 lCycles = (u8)(p[5] - p[2]) * lRound + (s32)((s16)(nTo - nFrom)) * uCost;   // u8: g_uExtraRounds wraps
+            s32 d = 0;
+
+            if(n == 0)
+            {
+                g_alJitterFirst[t] = lCycles;
+                lPrev = lCycles;
+            }
+            else
+                d = (s32)(lCycles - lPrev);
+
+            if(d > 127 || d < -127)
+            {
+                d = d > 0 ? 127 : -127;
+                g_auJitterClipped[t]++;
+            }
+
+            g_acJitterDelta[t][n] = (s8)d;
+            lPrev += d;
+        }
+    }
+
+    disableInterrupt();
+    g_pInterrupt = &customISR;
+    enableInterrupt();
+}
+#endif
+
+#if CLOCK_CHECK==1
+// ---------------------------------------------------------------------------
+// runClockWindow at both frequencies. The rounds of the loop are the time
+// base within the window, so the frame rate is found without knowing their
+// cost. Custom ISR must be active.
+//
+void runClockCheck(void)
+{
+    for(enum freq_variant f = 0; f < FREQ_COUNT; f++)
+    {
+        setPALRefreshRate((bool)f);
+        halt();
+
+        disableInterrupt();
+        g_lClockVBLFirst = 0;
+        g_lClockVBLLast  = 0;
+        g_lClockIter     = 0;
+        g_pInterrupt     = &customClockISR;
+        enableInterrupt();
+
+        runClockWindow(CLOCK_SECONDS);  // returns with interrupts disabled
+
+        g_alClockIter[f]   = g_lClockIter;
+        g_alClockVBL[f]    = g_lClockVBLLast - g_lClockVBLFirst;
+        g_anClockFrames[f] = g_nClockFrames;
+
+        g_pInterrupt = &customISR;
+        enableInterrupt();
+    }
+}
+#endif
+
+// ---------------------------------------------------------------------------
+void runAllIterations(void)
+{
+
+    savePalette();      // out9A trashes the palette
+ 
+    bool bPALOrg = getPALRefreshRate();
+
+    setCustomISR();
+
+#if SELF_CALIBRATION==1
+    runSelfCalibration();
+#endif
+
+    for(enum freq_variant f = 0; f < FREQ_COUNT; f++)
+    {
+        setPALRefreshRate((bool)f);
+        halt();                 // halt here is needed on AX-370, otherwise we get skewed results
+
+        if(g_eTimebase == TIMEBASE_S1990)
+            g_anTimerFrameTicks[f] = measureFramesS1990(TIMER_FRAMES);
+
+        for(u8 t = 0; t < arraysize(g_aoTest); t++)
+        {
+
+#if DEBUG_INSERT_TURBO_MID_TEST==1
+    if(t == 11)
+        enableTurboIfAvailable(true);
+    else if(t == 12)
+        enableTurboIfAvailable(false);
+#endif
+
+            setupTestInMemory(t);
+
+            if(g_eTimebase == TIMEBASE_S1990)
+                runTimedIteration(f, t);
+            else
+                runAdaptiveIterations(f, t);
+
+            restoreVDPAfterTest();
+        }
+    }
+
+#if VERNIER==1
+    runVernier();
+#endif
+
+#if JITTER==1
+    runJitter();
+#endif
+
+#if USE_LINE_INT_TIMEBASE==1
+    runAllLineIterations();
+#endif
+
+    runAllLongTests();
+
+#if BLOCK_BENCH==1
+    runBlockBench();
+#endif
+
+#if OPCODE_SWEEP==1
+    runOpcodeSweep();
+#endif
+
+#if PORT_SWEEP==1
+    runPortSweep();
+#endif
+
+#if MEMORY_ATLAS==1
+    runMemoryAtlas();
+#endif
+
+#if CLOCK_CHECK==1
+    runClockCheck();
+#endif
+
+    setPALRefreshRate(bPALOrg);
+
+    restoreOriginalISR();       // sets ROM in page 0 too
+}
+
+// ---------------------------------------------------------------------------
+// Because SDCC does not come out of the box with support for %f (or %.2f in
+// our case), we manually split it up in two %d. Rounded to hundredths, as a
+// "round(val, 2)". x must not be negative
+void fixToIntWith2Decimals(fix8 x, IntWith2Decimals* pObj)
+{
+    u32 lHundredths = ((u32)x * 100 + 128) >> FIX_SHIFT;
+
+    pObj->lInt  = lHundredths / 100;
+    pObj->uFrac = (u8)(lHundredths % 100);
+}
+
+// ---------------------------------------------------------------------------
+// On R800 the S1990 inserts I/O wait on VDP access. Show what is added on top
+// of the plain R800 instruction cost, for every test touching the VDP.
+//
+void printR800WaitReport(void)
+{
+    print(g_szR800WaitHdr);
+
+    for(u8 t = 0; t < arraysize(g_aoTest); t++)
+    {
+        if(!g_aoTest[t].bVDPPort)
+            continue;
+
+        IntWith2Decimals oWaitNTSC, oWaitPAL;
+        fix8 xWaitNTSC = g_axFinalTestCost[NTSC][t] - toFix(getRealSingleCost(t));
+        fix8 xWaitPAL = g_axFinalTestCost[PAL][t] - toFix(getRealSingleCost(t));
+
+        fixToIntWith2Decimals(xWaitNTSC < 0 ? -xWaitNTSC : xWaitNTSC, &oWaitNTSC);
+        fixToIntWith2Decimals(xWaitPAL < 0 ? -xWaitPAL : xWaitPAL, &oWaitPAL);
+
+        formatText(g_auBuffer,
+                g_szR800WaitVals,
+                g_aoTest[t].szTestName,
+                xWaitNTSC < 0 ? '-' : '+',
+                oWaitNTSC.lInt,
+                oWaitNTSC.uFrac,
+                xWaitPAL < 0 ? '-' : '+',
+                oWaitPAL.lInt,
+                oWaitPAL.uFrac
+               );
+
+        printX(g_auBuffer);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// The adaptive runner: how many iterations each test needed, and the spread
+//
+void printRobustReport(void)
+{
+    print(g_szRobustHdr);
+
+    for(u8 t = 0; t < arraysize(g_aoTest); t++)
+    {
+        IntWith2Decimals oSDNTSC, oSDPAL;
+
+        fixToIntWith2Decimals(g_axFrameInstrResultSD[NTSC][t], &oSDNTSC);
+        fixToIntWith2Decimals(g_axFrameInstrResultSD[PAL][t], &oSDPAL);
+
+        formatText(g_auBuffer,
+                g_szRobustVals,
+                g_aoTest[t].szTestName,
+                g_aoFrameStats[NTSC][t].uCount,
+                g_alFrameInstrResultMed[NTSC][t],
+                oSDNTSC.lInt,
+                oSDNTSC.uFrac,
+                g_auOutliers[NTSC][t],
+
+                g_aoFrameStats[PAL][t].uCount,
+                g_alFrameInstrResultMed[PAL][t],
+                oSDPAL.lInt,
+                oSDPAL.uFrac,
+                g_auOutliers[PAL][t]
+               );
+
+        printX(g_auBuffer);
+    }
+}
+
+// ---------------------------------------------------------------------------
+//
+void printReport(void)
+{
+    printX(g_szRemoveWait);
+
+    // First the frame cycle speed
+    printX(g_szSpeedHdrCols);
+
+    u16 nTotalOverhead = g_eTimebase == TIMEBASE_S1990 ? 0 : getFrameOverheadCycles(); // timer measures the full frame
+
+    u32 lFrmTotalCyclesNTSC;
+    u32 lFrmTotalCyclesPAL;
+    s32 dDiffPAL;
+    s32 dDiffNTSC;
+
+    lFrmTotalCyclesNTSC = unsignedRound(g_axFrmTotalCycles[NTSC]) + nTotalOverhead;
+    dDiffNTSC = (s32)(lFrmTotalCyclesNTSC - alFRAME_CYCLES_TARGET[g_eCPUMode][NTSC]);
+
+    lFrmTotalCyclesPAL = unsignedRound(g_axFrmTotalCycles[PAL]) + nTotalOverhead;
+    dDiffPAL = (s32)(lFrmTotalCyclesPAL - alFRAME_CYCLES_TARGET[g_eCPUMode][PAL]);
+
+    u8 szBuf1[50];
+    u8 szBuf2[50];
+
+    formatText(szBuf1,
+            g_szSRPart,
+            lFrmTotalCyclesNTSC,
+            alFRAME_CYCLES_TARGET[g_eCPUMode][NTSC],
+            dDiffNTSC);
+
+    formatText(szBuf2,
+            g_szSRPart,
+            lFrmTotalCyclesPAL,
+            alFRAME_CYCLES_TARGET[g_eCPUMode][PAL],
+            dDiffPAL);
+
+
+    formatText(g_auBuffer,
+            g_szSpeedResult,
+            szBuf1,
+            szBuf2
+           );
+
+    printX(g_auBuffer);
+    print(g_szSplitline);
+
+    // Then the tests
+    if(g_eTimebase == TIMEBASE_S1990)
+        print(g_szReportColsS1990);
+    else
+        print(isR800(g_eCPUMode) ? g_szReportColsR800 : g_szReportCols);
+    // for(u8 t = CALIBRATION_TESTS; t < arraysize(g_aoTest); t++)
+    for(u8 t = 0; t < arraysize(g_aoTest); t++)
+    {
+        IntWith2Decimals oAvgNTSC, oAvgPAL, oTestCostNTSC, oTestCostPAL;
+
+        fixToIntWith2Decimals(g_axFrameInstrResultAvg[NTSC][t], &oAvgNTSC);
+        fixToIntWith2Decimals(g_axFrameInstrResultAvg[PAL][t], &oAvgPAL);
+        fixToIntWith2Decimals(g_axFinalTestCost[NTSC][t], &oTestCostNTSC);
+        fixToIntWith2Decimals(g_axFinalTestCost[PAL][t], &oTestCostPAL);
+
+        s8 sDiffNTSC = signedRoundX(g_axFinalTestCost[NTSC][t] - toFix(getRealSingleCost(t)));
+        s8 sDiffPAL = signedRoundX(g_axFinalTestCost[PAL][t] - toFix(getRealSingleCost(t)));
+
+        if(g_eTimebase == TIMEBASE_S1990)
+        {
+            formatText(g_auBuffer,
+                    g_szReportValsS1990,
+                    g_aoTest[t].szTestName,
+                    g_alTimerTicksFull[NTSC][t] / NUM_ITERATIONS,
+                    g_alTimerTicksHalf[NTSC][t] / NUM_ITERATIONS,
+                    oTestCostNTSC.lInt,
+                    oTestCostNTSC.uFrac,
+                    sDiffNTSC,
+
+                    g_alTimerTicksFull[PAL][t] / NUM_ITERATIONS,
+                    g_alTimerTicksHalf[PAL][t] / NUM_ITERATIONS,
+                    oTestCostPAL.lInt,
+                    oTestCostPAL.uFrac,
+                    sDiffPAL
+                   );
+
+            printX(g_auBuffer);
+            continue;
+        }
+
+        if(isR800(g_eCPUMode))
+        {
+            formatText(g_auBuffer,
+                    g_szReportValsR800,
+                    g_aoTest[t].szTestName,
+                    unsignedRound(g_axFrameInstrResultAvg[NTSC][t]),
+                    g_aoFrameStats[NTSC][t].lMin,
+                    g_aoFrameStats[NTSC][t].lMax,
+                    oTestCostNTSC.lInt,
+                    oTestCostNTSC.uFrac,
+                    sDiffNTSC,
+
+                    unsignedRound(g_axFrameInstrResultAvg[PAL][t]),
+                    g_aoFrameStats[PAL][t].lMin,
+                    g_aoFrameStats[PAL][t].lMax,
+                    oTestCostPAL.lInt,
+                    oTestCostPAL.uFrac,
+                    sDiffPAL
+                   );
+
+            printX(g_auBuffer);
+            continue;
+        }
+
+        formatText(g_auBuffer,
+                g_szReportValues,
+                g_aoTest[t].szTestName,
+                oAvgNTSC.lInt,
+                oAvgNTSC.uFrac,
+                g_aoFrameStats[NTSC][t].lMin,
+                g_aoFrameStats[NTSC][t].lMax,
+                oTestCostNTSC.lInt,
+                oTestCostNTSC.uFrac,
+                sDiffNTSC,
+
+                oAvgPAL.lInt,
+                oAvgPAL.uFrac,
+                g_aoFrameStats[PAL][t].lMin,
+                g_aoFrameStats[PAL][t].lMax,
+                oTestCostPAL.lInt,
+                oTestCostPAL.uFrac,
+                sDiffPAL
+               );
+
+        printX(g_auBuffer);
+    }
+
+    if(g_eTimebase == TIMEBASE_VBLANK)
+        printRobustReport();
+
+    formatText(g_auBuffer, g_szLongHdr, getLongFrames());
+    printX(g_auBuffer);
+
+    for(u8 t = CALIBRATION_TESTS; t < arraysize(g_aoTest); t++)
+    {
+        if(!isLongTest(t))
+            continue;
+
+        IntWith2Decimals oCost, oWait;
+        fix8 xWait = g_axLongTestCost[t] - toFix(getRealSingleCost(t));
+
+        fixToIntWith2Decimals(g_axLongTestCost[t], &oCost);
+        fixToIntWith2Decimals(xWait < 0 ? -xWait : xWait, &oWait);
+
+        formatText(g_auBuffer,
+                g_szLongVals,
+                g_aoTest[t].szTestName,
+                oCost.lInt,
+                oCost.uFrac,
+                xWait < 0 ? '-' : '+',
+                oWait.lInt,
+                oWait.uFrac
+               );
+
+        printX(g_auBuffer);
+    }
+
+    if(isR800(g_eCPUMode))
+        printR800WaitReport();
+
+    // print(g_szNewline);
+    printX(g_szSummary);
+}
+
+// ---------------------------------------------------------------------------
+// Same columns as the main report, but the counts are per sample (LINE_INT_STEP
+// lines) instead of per frame
+//
+void printLineReport(void)
+{
+    IntWith2Decimals oCPLNTSC, oCPLPAL;
+
+    formatText(g_auBuffer, g_szLineHdr, LINE_INT_STEP, NUM_ITERATIONS * (LINE_SAMPLES - 1));
+    printX(g_auBuffer);
+
+    fixToIntWith2Decimals(g_axLineCyclesPerLine[NTSC], &oCPLNTSC);
+    fixToIntWith2Decimals(g_axLineCyclesPerLine[PAL], &oCPLPAL);
+    formatText(g_auBuffer, g_szLineCPL, oCPLNTSC.lInt, oCPLNTSC.uFrac, oCPLPAL.lInt, oCPLPAL.uFrac);
+    printX(g_auBuffer);
+
+    print(g_szReportCols);
+    for(u8 t = 0; t < arraysize(g_aoTest); t++)
+    {
+        IntWith2Decimals oAvgNTSC, oAvgPAL, oTestCostNTSC, oTestCostPAL;
+
+        fixToIntWith2Decimals(fixDiv(g_alLineInstrSum[NTSC][t], NUM_ITERATIONS * (LINE_SAMPLES - 1)), &oAvgNTSC);
+        fixToIntWith2Decimals(fixDiv(g_alLineInstrSum[PAL][t], NUM_ITERATIONS * (LINE_SAMPLES - 1)), &oAvgPAL);
+        fixToIntWith2Decimals(g_axLineTestCost[NTSC][t], &oTestCostNTSC);
+        fixToIntWith2Decimals(g_axLineTestCost[PAL][t], &oTestCostPAL);
+
+        s8 sDiffNTSC = signedRoundX(g_axLineTestCost[NTSC][t] - toFix(getRealSingleCost(t)));
+        s8 sDiffPAL = signedRoundX(g_axLineTestCost[PAL][t] - toFix(getRealSingleCost(t)));
+
+        formatText(g_auBuffer,
+                g_szReportValues,
+                g_aoTest[t].szTestName,
+                oAvgNTSC.lInt,
+                oAvgNTSC.uFrac,
+                (u32)g_anLineInstrMin[NTSC][t],
+                (u32)g_anLineInstrMax[NTSC][t],
+                oTestCostNTSC.lInt,
+                oTestCostNTSC.uFrac,
+                sDiffNTSC,
+
+                oAvgPAL.lInt,
+                oAvgPAL.uFrac,
+                (u32)g_anLineInstrMin[PAL][t],
+                (u32)g_anLineInstrMax[PAL][t],
+                oTestCostPAL.lInt,
+                oTestCostPAL.uFrac,
+                sDiffPAL
+               );
+
+        printX(g_auBuffer);
+    }
+}
+
+#if VRAM_MATRIX==1
+// ---------------------------------------------------------------------------
+// One block per screen mode, a line per VDP test
+//
+void printVRAMMatrix(void)
+{
+    print(g_szMatrixHdr);
+
+    for(u8 m = 0; m < arraysize(g_auMatrixModes); m++)
+    {
+        formatText(g_auBuffer, g_szMatrixCols, g_auMatrixModes[m]);
+        printX(g_auBuffer);
+
+        u8 i = 0;
+        for(u8 t = 0; t < arraysize(g_aoTest) && i < MATRIX_MAX_TESTS; t++)
+        {
+            if(!g_aoTest[t].bVDPPort)
+                continue;
+
+            u8* p = g_auBuffer;
+            p += formatText(p, g_szMatrixName, g_aoTest[t].szTestName);
+
+            for(u8 v = 0; v < MATRIX_VARIANTS; v++)
+            {
+                IntWith2Decimals oCost;
+                fix8 xCost = g_axMatrixCost[m][v][i];
+
+                fixToIntWith2Decimals(xCost, &oCost);
+
+                if(xCost == 0)
+                    p += formatText(p, g_szMatrixNotRun);
+                else
+                    p += formatText(p, g_szMatrixCell, oCost.lInt, oCost.uFrac);
+            }
+
+            formatText(p, g_szNewline);
+            printX(g_auBuffer);
+            i++;
+        }
+    }
+}
+#endif
+
+#if LINE_PROFILE==1
+// ---------------------------------------------------------------------------
+// The segments of a sample hold the same amount of cycles, as the line ISR
+// is the same. As in calcLineStatistics, the calibration tests give them.
+// One block per VDP test, 8 segments per line
+//
+void printLineProfile(void)
+{
+    u8 uTail = getTailCycleCost();
+
+    formatText(g_auBuffer, g_szProfileHdr, LINE_INT_STEP, LINE_INT_FIRST + LINE_INT_STEP, (g_uBIOS_RG9SAV & 0x80) ? 212 : 192);
+    printX(g_auBuffer);
+
+    u8 uRow = CALIBRATION_TESTS;
+    for(u8 t = CALIBRATION_TESTS; t < arraysize(g_aoTest) && uRow < CALIBRATION_TESTS + MATRIX_MAX_TESTS; t++)
+    {
+        if(!g_aoTest[t].bVDPPort)
+            continue;
+
+        for(u8 s = 0; s < PROFILE_SAMPLES - 1; s += 8)
+        {
+            u8* p = g_auBuffer;
+            p += formatText(p, g_szProfileRow, s == 0 ? g_aoTest[t].szTestName : (u8*)"", LINE_INT_FIRST + LINE_INT_STEP * (s + 1));
+
+            for(u8 i = s; i < s + 8 && i < PROFILE_SAMPLES - 1; i++)
+            {
+                IntWith2Decimals oCost;
+                u32 lCycles = 0;
+
+                for(u8 c = 0; c < CALIBRATION_TESTS; c++)
+                    lCycles += (u32)g_anProfileInstr[c][i] * getRealSingleCost(c) + (u32)g_auProfileXtra[c][i] * uTail;
+
+                fixToIntWith2Decimals(fixDiv(lCycles - (u32)CALIBRATION_TESTS * g_auProfileXtra[uRow][i] * uTail,
+                                             (u32)CALIBRATION_TESTS * g_anProfileInstr[uRow][i]), &oCost);
+                p += formatText(p, g_szProfileCell, oCost.lInt, oCost.uFrac);
+            }
+
+            formatText(p, g_szNewline);
+            printX(g_auBuffer);
+        }
+
+        uRow++;
+    }
+}
+#endif
+
+#if CMD_CONTENTION==1
+// ---------------------------------------------------------------------------
+//
+void printCommandContention(void)
+{
+    print(g_szContentionHdr);
+    print(g_szContentionCols);
+
+    u8 i = 0;
+    for(u8 t = 0; t < arraysize(g_aoTest) && i < MATRIX_MAX_TESTS; t++)
+    {
+        if(!g_aoTest[t].bVDPPort)
+            continue;
+
+        IntWith2Decimals oIdle, oBusy, oAdded;
+        fix8 xAdded = g_axContentionCost[1][i] - g_axContentionCost[0][i];
+
+        fixToIntWith2Decimals(g_axContentionCost[0][i], &oIdle);
+        fixToIntWith2Decimals(g_axContentionCost[1][i], &oBusy);
+        fixToIntWith2Decimals(xAdded < 0 ? -xAdded : xAdded, &oAdded);
+
+        formatText(g_auBuffer,
+                g_szContentionVals,
+                g_aoTest[t].szTestName,
+                oIdle.lInt,
+                oIdle.uFrac,
+                oBusy.lInt,
+                oBusy.uFrac,
+                xAdded < 0 ? '-' : '+',
+                oAdded.lInt,
+                oAdded.uFrac
+               );
+
+        printX(g_auBuffer);
+        i++;
+    }
+}
+#endif
+
+#if V9958_WTE==1
+// ---------------------------------------------------------------------------
+//
+void printWaitMode(void)
+{
+    if(!g_bWaitRun)
+    {
+        print(g_szWaitNoV9958);
+        return;
+    }
+
+    print(g_szWaitHdr);
+    print(g_szWaitCols);
+
+    u8 i = 0;
+    for(u8 t = 0; t < arraysize(g_aoTest) && i < MATRIX_MAX_TESTS; t++)
+    {
+        if(!g_aoTest[t].bVDPPort)
+            continue;
+
+        IntWith2Decimals oIdle, oBusy, oIdleWTE, oBusyWTE;
+
+        fixToIntWith2Decimals(g_axWaitCost[0][0][i], &oIdle);
+        fixToIntWith2Decimals(g_axWaitCost[0][1][i], &oBusy);
+        fixToIntWith2Decimals(g_axWaitCost[1][0][i], &oIdleWTE);
+        fixToIntWith2Decimals(g_axWaitCost[1][1][i], &oBusyWTE);
+
+        formatText(g_auBuffer,
+                g_szWaitVals,
+                g_aoTest[t].szTestName,
+                oIdle.lInt,
+                oIdle.uFrac,
+                oBusy.lInt,
+                oBusy.uFrac,
+                oIdleWTE.lInt,
+                oIdleWTE.uFrac,
+                oBusyWTE.lInt,
+                oBusyWTE.uFrac
+               );
+
+        printX(g_auBuffer);
+        i++;
+    }
+}
+#endif
+
+#if VDP_CMD_BENCH==1
+// ---------------------------------------------------------------------------
+// One block per screen mode, a line per command
+//
+void printVDPCommandBench(void)
+{
+    formatText(g_auBuffer, g_szCmdHdr, VDPCMD_NX, VDPCMD_NY);
+    printX(g_auBuffer);
+
+    for(u8 m = 0; m < arraysize(g_auCmdModes); m++)
+    {
+        if(g_alCmdPixels[m][0][0] == 0)
+            continue;
+
+        formatText(g_auBuffer, g_szCmdCols, g_auCmdModes[m]);
+        printX(g_auBuffer);
+
+        for(u8 c = 0; c < arraysize(g_auCmdCodes); c++)
+        {
+            u8* p = g_auBuffer;
+            p += formatText(p, g_szCmdName, g_aszCmdNames[c]);
+
+            for(u8 v = 0; v < MATRIX_VARIANTS; v++)
+            {
+                u32 lPixels = g_alCmdPixels[m][v][c];
+                p += formatText(p, g_szCmdCell, lPixels, lPixels * g_auCmdModeBpp[m] / 8);
+            }
+
+            formatText(p, g_szNewline);
+            printX(g_auBuffer);
+        }
+    }
+}
+#endif
+
+#if OPCODE_SWEEP==1
+// ---------------------------------------------------------------------------
+// One table per prefix, 8 opcodes per line
+//
+void printSweepReport(void)
+{
+    for(enum sweep_table e = 0; e < SWEEP_TABLE_COUNT; e++)
+    {
+        formatText(g_auBuffer, g_szSweepHdr, e == SWEEP_BASE ? (u8*)"none" : g_aszSweepTable[e]);
+        printX(g_auBuffer);
+
+        for(u16 n = 0; n < 256; n += 8)
+        {
+            u8* p = g_auBuffer;
+            p += formatText(p, g_szSweepRow, g_aszSweepTable[e], n);
+
+            for(u8 i = 0; i < 8; i++)
+            {
+                u16 nCost = g_anSweepCost[e][n + i];
+
+                if(nCost == SWEEP_NOT_RUN)
+                    p += formatText(p, g_szSweepNotRun);
+                else
+                    p += formatText(p, g_szSweepCell, nCost / 100, nCost % 100);
+            }
+
+            formatText(p, g_szNewline);
+            printX(g_auBuffer);
+        }
+    }
+}
+#endif
+
+#if PORT_SWEEP==1
+// ---------------------------------------------------------------------------
+// in, then out, 8 ports per line
+//
+void printPortSweep(void)
+{
+    for(u8 d = 0; d < 2; d++)
+    {
+        formatText(g_auBuffer, g_szPortHdr, d == 0 ? "in a,(n)" : "out (n),a");
+        printX(g_auBuffer);
+
+        for(u16 n = 0; n < 256; n += 8)
+        {
+            u8* p = g_auBuffer;
+            p += formatText(p, g_szSweepRow, g_aszPortDir[d], n);
+
+            for(u8 i = 0; i < 8; i++)
+            {
+                u16 nCost = g_anPortCost[d][n + i];
+
+                if(nCost == SWEEP_NOT_RUN)
+                    p += formatText(p, g_szSweepNotRun);
+                else
+                    p += formatText(p, g_szSweepCell, nCost / 100, nCost % 100);
+            }
+
+            formatText(p, g_szNewline);
+            printX(g_auBuffer);
+        }
+    }
+}
+#endif
+
+#if VERNIER==1
+// ---------------------------------------------------------------------------
+// The range of the interrupt in the block, and what the heuristic
+// FRAME_COUNT_ADD_UP would have had to be for sync1
+//
+void printVernier(void)
+{
+    if(isR800(g_eCPUMode) || g_eTimebase == TIMEBASE_S1990)
+        return;
+
+    printX(g_szVernierHdr);
+
+    for(u8 f = 0; f < FREQ_COUNT; f++)
     {
-        // u32 lTestBlocksInSegment = ((u32)(0x4000 - SIZE_TAIL_BLOCK) / uUnrollInstrSize);
-        u32 lTestBlocksInSegment = (u32)0x4000 / uUnrollInstrSize; // the above should be correct, but this one seems to empirically hit better (no decimals)
-        lTestBlocksInSegment = (lTestBlocksInSegment * uUnrollInstrSize) / uUnrollSingleInstrSize; // two divs on purpose
-        u32 lBlockCost = lTestBlocksInSegment * g_uExtraRounds;
+        if(g_alVernierHigh[f] == 0)
+            formatText(g_auBuffer, g_szVernierNone, g_aszFreq[f]);
+        else
+        {
+            IntWith2Decimals oAddUp;
+            fix8 xAddUp = g_axFrmTotalCyclesNoTail[f] / getRealSingleCost(0) - g_axFrameInstrResultAvg[f][0];
+            fixToIntWith2Decimals(xAddUp < 0 ? -xAddUp : xAddUp, &oAddUp);     // the sign apart, x must not be negative
+            formatText(g_auBuffer, g_szVernierVals, g_aszFreq[f], g_alVernierLow[f], g_alVernierHigh[f],
+                       xAddUp < 0 ? '-' : '+', oAddUp.lInt, oAddUp.uFrac);
+        }
 
-        lInstructions += lBlockCost;
+        printX(g_auBuffer);
     }
-
-    g_alFrameInstrResult[eFreq][uTest][uIterationNum] = lInstructions;
 }
+#endif
 
+#if JITTER==1
 // ---------------------------------------------------------------------------
-void calcStatistics(void)
+// Per sync test: the shortest frame, the spread and the mean over it, a
+// histogram of the frames over the shortest one, and the autocorrelation over
+// the whole run. A periodic pattern shows up as a peak at its lag
+//
+void printJitter(void)
 {
-    for(u8 f = 0; f < FREQ_COUNT; f++)
+    formatText(g_auBuffer, g_szJitterHdr, JITTER_FRAMES);
+    printX(g_auBuffer);
+
+    for(u8 t = 0; t < CALIBRATION_TESTS; t++)
     {
-        for(u8  t = 0; t < arraysize(g_aoTest); t++)
-        {
-            u32 lTotal = 0;
-            u32 lMin = (u32)-1; // Wraps around to maximum u32 value
-            u32 lMax = 0;
+        u8 uCost = getRealSingleCost(t);
+        s32 l = 0;
+        s32 lMin = 0;
+        s32 lMax = 0;
+        s32 lSum = 0;
 
-            u8 uExtra = 0;
+        for(u16 i = 0; i < JITTER_FRAMES; i++)  // cycles over the first frame
+        {
+            l += g_acJitterDelta[t][i];
+            lSum += l;
 
-            for(u8 i=0; i<NUM_ITERATIONS; i++)
-            {
-                u32 n = g_alFrameInstrResult[f][t][i];
+            if(l < lMin)
+                lMin = l;
 
-                lTotal += n;
+            if(l > lMax)
+                lMax = l;
+        }
 
-                if(n < lMin)
-                    lMin = n;
+        fix8 xMean = toFix(lSum) / JITTER_FRAMES - toFix(lMin);
+        u16 anBin[JITTER_BINS];
+        s32 alCov[JITTER_LAGS + 1];     // lag 0 is the variance
+        fix8 axDev[JITTER_LAGS + 1];    // the last frames, from the mean, by i % (JITTER_LAGS + 1)
 
-                if(n > lMax)
-                    lMax = n;
+        memset(anBin, 0, sizeof(anBin));
+        memset(alCov, 0, sizeof(alCov));
 
-                if(g_auFrameInstrResultXtra[f][t][i] > uExtra)
-                    uExtra = g_auFrameInstrResultXtra[f][t][i];
-            }
+        l = 0;
+        for(u16 i = 0; i < JITTER_FRAMES; i++)
+        {
+            l += g_acJitterDelta[t][i];
 
-            if(t<CALIBRATION_TESTS) // max out on the calibration tests.
-                g_afFrameInstrResultAvg[f][t] = lMax;
-            else
-                g_afFrameInstrResultAvg[f][t] = (float)lTotal/NUM_ITERATIONS;
+            u32 lOff = (u32)(l - lMin) / uCost;     // in sync instructions, which keeps the products below in range
+            anBin[lOff < JITTER_BINS ? lOff : JITTER_BINS - 1]++;
 
-            g_alFrameInstrResultMin[f][t] = lMin;
-            g_alFrameInstrResultMax[f][t] = lMax;
+            u8 uAt = i % (JITTER_LAGS + 1);
+            axDev[uAt] = (toFix(l - lMin) - xMean) / uCost;
 
-            g_auFrameInstrResultXtr2[f][t] = uExtra;
+            for(u8 k = 0; k <= JITTER_LAGS && k <= i; k++)
+                alCov[k] += (axDev[uAt] * axDev[(uAt + JITTER_LAGS + 1 - k) % (JITTER_LAGS + 1)]) >> FIX_SHIFT;
         }
-    }
 
+        IntWith2Decimals oMean;
+        fixToIntWith2Decimals(xMean, &oMean);
+        formatText(g_auBuffer, g_szJitterTest, g_aoTest[t].szTestName, g_alJitterFirst[t] + lMin,
+                   (u32)(lMax - lMin), oMean.lInt, oMean.uFrac, g_auJitterClipped[t]);
+        printX(g_auBuffer);
 
-    // Store the first test run as master timing for each frequency
-    for(u8 f = 0; f < FREQ_COUNT; f++)
-    {
-        g_afFrmTotalCyclesNoTail[f] = ((g_afFrameInstrResultAvg[f][0] + FRAME_COUNT_ADD_UP) * g_aoTest[0].uRealSingleCost +
-                                       (g_afFrameInstrResultAvg[f][1] + FRAME_COUNT_ADD_UP) * g_aoTest[1].uRealSingleCost) / 2;
+        u32 lLastBin = (u32)(lMax - lMin) / uCost;
 
-        u8 uFrmCycles = FRAME_CYCLES_TAIL_Z80;
-        if(g_eCPUMode == Z80_TURBO )
-            uFrmCycles += FRAME_CYCLES_TAIL_Z80_TURBO_ADD;
+        for(u8 b = 0; b < JITTER_BINS && b <= lLastBin; b++)
+        {
+            u8* p = g_auBuffer;
+            bool bRest = b == JITTER_BINS - 1 && lLastBin > b;
 
-        g_afFrmTotalCycles[f] = g_afFrmTotalCyclesNoTail[f] + (g_auFrameInstrResultXtr2[f][0] + g_auFrameInstrResultXtr2[f][1]) * uFrmCycles / 2;
-    }
+            p += formatText(p, g_szJitterBin, (u32)b * uCost, bRest ? '+' : ' ', anBin[b]);
 
-    // populate the testcost float array
-    for(u8 f = 0; f < FREQ_COUNT; f++)
-        for(u8 t = 0; t < arraysize(g_aoTest); t++)
-            g_afFinalTestCost[f][t] = (g_afFrmTotalCyclesNoTail[f] + g_aoTest[0].uStartupCycleCost - g_aoTest[t].uStartupCycleCost) / g_afFrameInstrResultAvg[f][t];
+            for(u16 i = (u32)anBin[b] * JITTER_BAR / JITTER_FRAMES; i > 0; i--)
+                *p++ = '#';
 
-    u32 lAfter =  ((u32)g_uMinsH1 * 10 + g_uMinsL1) * 60 + ((u32)g_uSecondsH1 * 10 + g_uSecondsL1);
-    u32 lBefore = ((u32)g_uMinsH0 * 10 + g_uMinsL0) * 60 + ((u32)g_uSecondsH0 * 10 + g_uSecondsL0);
+            formatText(p, g_szNewline);
+            printX(g_auBuffer);
+        }
+
+        u8* p = g_auBuffer;
+        p += formatText(p, g_szJitterLags, JITTER_LAGS);
 
-    u16 nDiff = (s16)(lAfter - lBefore);
+        fix8 xVar = alCov[0] / JITTER_FRAMES;
 
-    if(g_eCPUMode == Z80_TURBO)
-        nDiff = (u16)(unsignedRound((float)nDiff * 1.5f));
+        if(xVar == 0)
+            p += formatText(p, g_szJitterFlat);
+        else
+            for(u8 k = 1; k <= JITTER_LAGS; k++)
+                p += formatText(p, g_szJitterLag, alCov[k] / (JITTER_FRAMES - k) * 100 / xVar);
 
-    g_iVDPDiff = (s16)(nDiff - 12); // 12 is norm - expected for 0 delay
+        formatText(p, g_szNewline);
+        printX(g_auBuffer);
+    }
 }
+#endif
 
+#if CLOCK_CHECK==1
+// ---------------------------------------------------------------------------
+// Cycles * 10000 / 3579545, for the ratio to the standard Z80 clock
+//
+u32 getClockRatio(u32 lHz)
+{
+    return lHz * 100 / 35795;
+}
 
 // ---------------------------------------------------------------------------
+// '!' if lHz is further from what we expect of the CPU mode than the error
+// and 1/200 on top
 //
-void runLongTest(void)
+u8 getClockMark(u32 lHz, u32 lErr)
 {
-    g_lEndTimeStamp = getTimeStamp();
+    u32 lNominal = alCLOCK_NOMINAL[g_eCPUMode];
+    u32 lDiff = lHz > lNominal ? lHz - lNominal : lNominal - lHz;
 
-    g_bRTCWorking = g_lEndTimeStamp != g_lStartTimeStamp;
+    return lDiff > lErr + lNominal / 200 ? '!' : ' ';
+}
 
-    if(!g_bRTCWorking)
-        return;
+// ---------------------------------------------------------------------------
+// Per frequency: the frame rate, from the frames over the loop rounds from the
+// first VBLANK to the last, and the RTC seconds over all the rounds. The CPU
+// clock from the frame cycles of the main test times that. On Z80 also the
+// CPU clock from the loop itself, as all its cycles are known (I/O wait on
+// turbo is not). Errors: one round at each end, and CLOCK_RTC_PPM
+//
+void printClockCheck(void)
+{
+    formatText(g_auBuffer, g_szClockHdr, CLOCK_SECONDS);
+    printX(g_auBuffer);
 
-#ifdef ROM_OUTPUT_FILE
+    u32 lLoopCycles = 0;
 
-    disableInterrupt();
-    memAPI_enaSltPg2_NI_fromC(g_uSlotidPage2ROM);
-    enableInterrupt();
-    ENABLE_SEGMENT_PAGE2(TEST_SEG_OFFSET+10);
+    for(u8 f = 0; f < FREQ_COUNT; f++)
+    {
+        u16 nFrames = g_anClockFrames[f];
+        u32 lDen = CLOCK_SECONDS * g_alClockVBL[f];
 
-#else
-    u8 uUnrollInstructionsSize = 2;
-    u16 nMax = (u16)((u32)(0x4000 - SIZE_LONGTEST_TAIL) / uUnrollInstructionsSize);
+        if(nFrames < 2 || g_alClockVBL[f] == 0)
+        {
+            formatText(g_auBuffer, g_szClockNone, g_aszFreq[f]);
+            printX(g_auBuffer);
+            continue;
+        }
 
-    u8* p = (u8*) &runTestAsmInMem;
+        u32 lNum = (u32)(nFrames - 1) * g_alClockIter[f];
+        u32 lRate = lNum / lDen * 1000 + ((lNum % lDen) >> 4) * 1000 / (lDen >> 4);  // mHz
+        u32 lRateErr = lRate * 4 / g_alClockVBL[f] + lRate / (1000000 / CLOCK_RTC_PPM) + 1;
 
-    for(u16 n = 0; n < nMax; n++)
-    {
-        memcpy(p, &TEST_LONGTEST_UNROLL, uUnrollInstructionsSize);
-        p += uUnrollInstructionsSize;
+        formatText(g_auBuffer, g_szClockFreq, g_aszFreq[f], lRate / 1000, lRate % 1000, lRateErr, nFrames);
+        printX(g_auBuffer);
+
+        u32 lFrm = unsignedRound(g_axFrmTotalCycles[f]) + (g_eTimebase == TIMEBASE_S1990 ? 0 : getFrameOverheadCycles()); // timer measures the full frame
+        u32 lHz = lFrm * (lRate / 1000) + lFrm * (lRate % 1000) / 1000;
+        u32 lErr = lFrm * lRateErr / 1000 + (u32)getRealSingleCost(0) * lRate / 1000;   // and one sync1 instruction per frame
+        u32 lRatio = getClockRatio(lHz);
+
+        formatText(g_auBuffer, g_szClockCPU, g_aszFreq[f], lHz, lErr, lRatio / 10000, lRatio % 10000, getClockMark(lHz, lErr));
+        printX(g_auBuffer);
+
+        u32 lIter = g_alClockIter[f];
+        lLoopCycles += lIter * CLOCK_LOOP_CYCLES + (lIter >> 16) * CLOCK_WRAP_CYCLES + (CLOCK_SECONDS - 1) * CLOCK_EDGE_CYCLES +
+                       (u32)nFrames * (CLOCK_ISR_CYCLES + FRAME_CYCLES_INT_KICK_OFF);
     }
 
-    memcpy(p, &TEST_LONGTEST_TAIL, SIZE_LONGTEST_TAIL);
-#endif
+    // Plain Z80 only: the I/O wait on turbo is not known, and the R800 loop is not counted
+    if(g_eCPUMode != Z80_PLAIN || g_anClockFrames[NTSC] < 2 || g_anClockFrames[PAL] < 2)
+        return;
 
-    setPALRefreshRate(false);
-    halt();                 // halt here is needed on AX-370, otherwise we get skewed results
-    longTest();
+    u32 lHz = lLoopCycles / (FREQ_COUNT * CLOCK_SECONDS);
+    u32 lErr = lHz / (1000000 / CLOCK_RTC_PPM) + 2 * CLOCK_LOOP_CYCLES / CLOCK_SECONDS;
+    u32 lRatio = getClockRatio(lHz);
+
+    formatText(g_auBuffer, g_szClockLoop, lHz, lErr, lRatio / 10000, lRatio % 10000, getClockMark(lHz, lErr));
+    printX(g_auBuffer);
 }
+#endif
 
+#if SELF_CALIBRATION==1
 // ---------------------------------------------------------------------------
-void runAllIterations(void)
+// Measured, and assumed (the FRAME_CYCLES_ constants) in brackets. Then the add-up estimated from
+// the sync overlap, which is not measured
+//
+void printSelfCalibration(void)
 {
-
-    initPalette();      // just in case we test/trash the palette
- 
-    bool bPALOrg = getPALRefreshRate();
-
-    setCustomISR();
-
-    for(enum freq_variant f = 0; f < FREQ_COUNT; f++)
+    if(g_bSelfCalibrated)
     {
-        setPALRefreshRate((bool)f);
-        halt();                 // halt here is needed on AX-370, otherwise we get skewed results
+        IntWith2Decimals oTail, oWait;
 
-        for(u8 t = 0; t < arraysize(g_aoTest); t++)
-        {
+        fixToIntWith2Decimals(g_xTailCycles, &oTail);
+        fixToIntWith2Decimals(g_xVDPIOWait, &oWait);
 
-#if DEBUG_INSERT_TURBO_MID_TEST==1
-    if(t == 11)
-        enableTurboIfAvailable(true);
-    else if(t == 12)
-        enableTurboIfAvailable(false);
-#endif
+        u16 nOverhead = getFrameOverheadCycles();
 
-            setupTestInMemory(t);
+        g_bSelfCalibrated = false;      // for the assumed ones
+        u8 uTailAssumed = getTailCycleCost();
+        u16 nOverheadAssumed = getFrameOverheadCycles();
+        g_bSelfCalibrated = true;
 
-            for(u8 i = 0; i < NUM_ITERATIONS; i++)
-                runIteration(f, t, i);
-        }
+        printX(g_szCalibHdr);
+        formatText(g_auBuffer, g_szCalibVals, oTail.lInt, oTail.uFrac, uTailAssumed, oWait.lInt, oWait.uFrac, nOverhead, nOverheadAssumed);
+        printX(g_auBuffer);
     }
 
-    if(g_eCPUMode <= Z80_TURBO)
-        runLongTest();
+    if(g_eTimebase == TIMEBASE_S1990 || getRealSingleCost(0) == getRealSingleCost(1))
+        return;                         // the frame is timed, or there is no overlap to estimate from
 
-    setPALRefreshRate(bPALOrg);
+    IntWith2Decimals aoAddUp[FREQ_COUNT];
+    u8 acSign[FREQ_COUNT];
 
-    restoreOriginalISR();       // sets ROM in page 0 too
-    restorePalette();           // uses BIOS. just in case the palette was messed up
-}
+    for(u8 f = 0; f < FREQ_COUNT; f++)
+    {
+        fix8 xAddUp = g_axFrmTotalCyclesNoTail[f] / getRealSingleCost(0) - g_axFrameInstrResultAvg[f][0];
 
-// ---------------------------------------------------------------------------
-// Because SDCC does not come out of the box with support for %f (or %.2f in
-// our case), we manually split it up in two %d. float adder (0.005) is as a
-// "round(val, 2)" when we truncate using ints
-void floatToIntWith2Decimals(float f, IntWith2Decimals* pObj)
-{
-    f += 0.005;
+        acSign[f] = xAddUp < 0 ? '-' : '+';
+        fixToIntWith2Decimals(xAddUp < 0 ? -xAddUp : xAddUp, &aoAddUp[f]);
+    }
 
-    float fFrac = f - (u32)f;
-    pObj->lInt  = (u32)f;
-    pObj->uFrac = (u8)(fFrac * 100);
+    formatText(g_auBuffer, g_szCalibAddUp, acSign[NTSC], aoAddUp[NTSC].lInt, aoAddUp[NTSC].uFrac, g_aszFreq[NTSC],
+                                           acSign[PAL], aoAddUp[PAL].lInt, aoAddUp[PAL].uFrac, g_aszFreq[PAL]);
+    printX(g_auBuffer);
 }
+#endif
 
+#if BLOCK_BENCH==1
 // ---------------------------------------------------------------------------
+// One line per block test: setup, final step and repeat step
 //
-void printReport(void)
+void printBlockBench(void)
 {
-    printX(g_szRemoveWait);
-
-    // First the frame cycle speed
-    printX(g_szSpeedHdrCols);
-
-    u16 nTotalOverhead = (u16)FRAME_CYCLES_INT + FRAME_CYCLES_INT_KICK_OFF + FRAME_CYCLES_COMMON_START + g_aoTest[0].uStartupCycleCost;
-
-    if(g_eCPUMode == Z80_TURBO )
-        nTotalOverhead += FRAME_CYCLES_INT_TURBO_ADD + FRAME_CYCLES_INT_KICK_OFF_TURBO_ADD + FRAME_CYCLES_COMMON_START_TURBO_ADD;
-
-    u32 lFrmTotalCyclesNTSC;
-    u32 lFrmTotalCyclesPAL;
-    s32 dDiffPAL;
-    s32 dDiffNTSC;
+    formatText(g_auBuffer, g_szBlockHdr, BLOCK_COUNT, getLongFrames());
+    printX(g_auBuffer);
+    printX(g_szBlockCols);
 
-    lFrmTotalCyclesNTSC = (u32)(g_afFrmTotalCycles[NTSC] + 0.5 + nTotalOverhead);
-    dDiffNTSC = (s32)(lFrmTotalCyclesNTSC - alFRAME_CYCLES_TARGET[g_eCPUMode][NTSC]);
+    for(u8 t = 0; t < arraysize(g_aoBlockTest); t++)
+    {
+        u8* p = g_auBuffer;
+        p += formatText(p, g_szBlockRow, g_aoBlockTest[t].szName, g_aszBlockMem[g_aoBlockTest[t].eFrom], g_aszBlockMem[g_aoBlockTest[t].eTo]);
 
-    lFrmTotalCyclesPAL = (u32)(g_afFrmTotalCycles[PAL] + 0.5 + nTotalOverhead);
-    dDiffPAL = (s32)(lFrmTotalCyclesPAL - alFRAME_CYCLES_TARGET[g_eCPUMode][PAL]);
+        for(u8 i = 0; i < 3; i++)
+        {
+            u8 auNum[12];
+            IntWith2Decimals oCost;
+            fix8 x = g_axBlockCost[t][i];
 
-    u8 szBuf1[50];
-    u8 szBuf2[50];
+            fixToIntWith2Decimals(x < 0 ? -x : x, &oCost);
+            formatText(auNum, g_szBlockNum, x < 0 ? '-' : ' ', oCost.lInt, oCost.uFrac);
+            p += formatText(p, g_szBlockCell, auNum);
+        }
 
-    sprintf(szBuf1,
-            g_szSRPart,
-            lFrmTotalCyclesNTSC,
-            alFRAME_CYCLES_TARGET[g_eCPUMode][NTSC],
-            dDiffNTSC);
+        formatText(p, g_szNewline);
+        printX(g_auBuffer);
+    }
+}
+#endif
 
-    sprintf(szBuf2,
-            g_szSRPart,
-            lFrmTotalCyclesPAL,
-            alFRAME_CYCLES_TARGET[g_eCPUMode][PAL],
-            dDiffPAL);
+#if MEMORY_ATLAS==1
+// ---------------------------------------------------------------------------
+// Signed, cycles added over internal RAM
+//
+u8 formatAtlasPenalty(u8* pBuf, u16 nCost, u16 nBase)
+{
+    u8 auNum[8];
+    s16 i = (s16)(nCost - nBase);
+    u8 cSign = '+';
 
+    if(i < 0)
+    {
+        cSign = '-';
+        i = -i;
+    }
 
-    sprintf(g_auBuffer,
-            g_szSpeedResult,
-            szBuf1,
-            szBuf2
-           );
+    formatText(auNum, g_szAtlasNum, cSign, i / 100, i % 100);
+    return formatText(pBuf, g_szAtlasCell, auNum);
+}
 
+// ---------------------------------------------------------------------------
+// The internal RAM costs, then one line per slot: mapper segments, min and
+// max over the segments of what every access adds, and what a read adds in
+// page 0 and 1
+//
+void printMemoryAtlas(void)
+{
+    printX(g_szAtlasHdr);
+    formatText(g_auBuffer, g_szAtlasBase, g_anAtlasBase[ATLAS_FETCH] / 100, g_anAtlasBase[ATLAS_FETCH] % 100,
+                                          g_anAtlasBase[ATLAS_READ] / 100, g_anAtlasBase[ATLAS_READ] % 100,
+                                          g_anAtlasBase[ATLAS_WRITE] / 100, g_anAtlasBase[ATLAS_WRITE] % 100);
     printX(g_auBuffer);
-    print(g_szSplitline);
+    printX(g_szAtlasCols);
 
-    // Then the tests
-    print(g_szReportCols);
-    // for(u8 t = CALIBRATION_TESTS; t < arraysize(g_aoTest); t++)
-    for(u8 t = 0; t < arraysize(g_aoTest); t++)
+    for(u8 i = 0; i < g_uAtlasSlots; i++)
     {
-        IntWith2Decimals oAvgNTSC, oAvgPAL, oTestCostNTSC, oTestCostPAL;
+        u8 uSlotID = g_auAtlasSlotID[i];
+        u8 cRAM = uSlotID == g_uSlotidPage2RAM ? '*' : ' ';
+        u8* p = g_auBuffer;
 
-        floatToIntWith2Decimals(g_afFrameInstrResultAvg[NTSC][t], &oAvgNTSC);
-        floatToIntWith2Decimals(g_afFrameInstrResultAvg[PAL][t], &oAvgPAL);
-        floatToIntWith2Decimals(g_afFinalTestCost[NTSC][t], &oTestCostNTSC);
-        floatToIntWith2Decimals(g_afFinalTestCost[PAL][t], &oTestCostPAL);
+        if(uSlotID & 0x80)
+            p += formatText(p, g_szAtlasSlotExp, uSlotID & 0x03, (uSlotID >> 2) & 0x03, cRAM);
+        else
+            p += formatText(p, g_szAtlasSlot, uSlotID, cRAM);
 
-        s8 sDiffNTSC = signedRoundX(g_afFinalTestCost[NTSC][t] - g_aoTest[t].uRealSingleCost);
-        s8 sDiffPAL = signedRoundX(g_afFinalTestCost[PAL][t] - g_aoTest[t].uRealSingleCost);
+        if(g_anAtlasSegments[i] == 0)
+            p += formatText(p, g_szAtlasNoRAM);
+        else
+            p += formatText(p, g_szAtlasSegs, g_anAtlasSegments[i]);
 
-        sprintf(g_auBuffer,
-                g_szReportValues,
-                g_aoTest[t].szTestName,
-                oAvgNTSC.lInt,
-                oAvgNTSC.uFrac,
-                g_alFrameInstrResultMin[NTSC][t],
-                g_alFrameInstrResultMax[NTSC][t],
-                oTestCostNTSC.lInt,
-                oTestCostNTSC.uFrac,
-                sDiffNTSC,
+        for(enum atlas_access e = 0; e < ATLAS_ACCESS_COUNT; e++)
+        {
+            u16* pnMinMax = g_anAtlasCost[i][e];
 
-                oAvgPAL.lInt,
-                oAvgPAL.uFrac,
-                g_alFrameInstrResultMin[PAL][t],
-                g_alFrameInstrResultMax[PAL][t],
-                oTestCostPAL.lInt,
-                oTestCostPAL.uFrac,
-                sDiffPAL
-               );
+            if(pnMinMax[0] == ATLAS_NOT_RUN)
+            {
+                p += formatText(p, g_szAtlasNotRun);
+            }
+            else
+            {
+                *p++ = ' ';
+                p += formatAtlasPenalty(p, pnMinMax[0], g_anAtlasBase[e]);
+                p += formatAtlasPenalty(p, pnMinMax[1], g_anAtlasBase[e]);
+            }
+        }
 
-        printX(g_auBuffer);
-    }
+        for(u8 uPage = 0; uPage < 2; uPage++)
+        {
+            if(g_anAtlasPageRead[i][uPage] == ATLAS_NOT_RUN)
+                p += formatText(p, g_szAtlasCell, "--");
+            else
+                p += formatAtlasPenalty(p, g_anAtlasPageRead[i][uPage], g_anAtlasBase[ATLAS_READ]);
+        }
 
-    u8* szLast;
-    u8 szBuf[50];
-    if(g_bRTCWorking)
-    {
-        sprintf(szBuf, g_szLongInfo, g_iVDPDiff);
-        szLast = (u8*)szBuf;
+        formatText(p, g_szNewline);
+        printX(g_auBuffer);
     }
-    else
-        szLast = (u8*)g_szLongRTCError;
-
-    sprintf(g_auBuffer, g_szLongTest, szLast);
-    printX(g_auBuffer);
-
-    // print(g_szNewline);
-    printX(g_szSummary);
 }
+#endif
 
 // ---------------------------------------------------------------------------
 //
@@ -1081,6 +4544,26 @@ void initRomIfAnyNI(void)
 #endif
 }
 
+#if USE_IM2==1
+// ---------------------------------------------------------------------------
+// IM 2: a vector table of 257 bytes, all V, page aligned in g_auIM2Area, and
+// a JP at V*0x101, right after the table. Whatever is on the data bus, the
+// ISR is the one in the JP (g_pInterrupt). Nothing in page 0 is used, so
+// there is no slot switch in page 0, and the kick-off cost is fixed.
+//
+void initIM2(void)
+{
+    u16 nTable = ((u16)g_auIM2Area + 0xFF) & 0xFF00;
+    u8 uVector = (u8)(nTable >> 8) + 1;
+    u8* pJP = (u8*)((u16)uVector * 0x101);
+
+    memset((u8*)nTable, uVector, 257);
+    *pJP = 0xC3;        // JP
+    g_ppInterruptIM2 = (void**)(pJP + 1);
+    g_uIM2Table = (u8)(nTable >> 8);
+}
+#endif
+
 // ---------------------------------------------------------------------------
 enum cpu_variant detectActiveCPU(void)
 {
@@ -1112,27 +4595,21 @@ u8 main(void)
 {
     initRomIfAnyNI();
 
+#if USE_IM2==1
+    initIM2();
+#endif
+
     if(getMSXType() == 0)
     {
         print(g_szErrorMSX);
         return 1;
     }
 
-    // safeguard against R800 until we support it properly
+#if DEBUG_FORCE_R800_FULLSPEED_IF_AVAILABLE==1
     s8 sOrgCPU = -1;
     if(getMSXType() == 3) // MSX turbo R
-    {
-        u8 uCPU = getCPU();
-        if(uCPU != 0)
-        {
-            sOrgCPU = (s8)uCPU;
-            changeCPU(0); // 0=Z80 (ROM) mode, 1=R800 ROM  mode, 2=R800 DRAM mode
-        }
-    }
+        sOrgCPU = (s8)getCPU();
 
-    g_lStartTimeStamp = getTimeStamp();
-
-#if DEBUG_FORCE_R800_FULLSPEED_IF_AVAILABLE==1
 enableR800FullSpeedIfAvailable(true);
 #endif
 
@@ -1142,14 +4619,49 @@ enableTurboIfAvailable(true);
 
     g_eCPUMode = detectActiveCPU();
 
-    sprintf(g_auBuffer, g_szGreeting, NUM_ITERATIONS, g_szMedium, g_aszCPUModes[ g_eCPUMode ]);
+    g_eTimebase = TIMEBASE_VBLANK;
+#if USE_S1990_TIMER_IF_AVAILABLE==1
+    if(getMSXType() == 3) // MSX turbo R
+        g_eTimebase = TIMEBASE_S1990;
+#endif
+
+#if VRAM_MATRIX==1
+    runVRAMMatrix();        // changes screen modes and clears the screen, so before anything is printed
+#endif
+
+#if VDP_CMD_BENCH==1
+    runVDPCommandBench();   // as above
+#endif
+
+#if CMD_CONTENTION==1
+    runCommandContention(); // as above
+#endif
+
+#if V9958_WTE==1
+    runWaitMode();          // as above
+#endif
+
+    formatText(g_auBuffer, g_szGreeting, MIN_ITERATIONS, MAX_ITERATIONS, g_szMedium, g_aszCPUModes[ g_eCPUMode ]);
     printX(g_auBuffer);
 
+    if(g_eTimebase == TIMEBASE_S1990)
+        print(g_szTimebaseS1990);
+
     print(g_szWait);
 
     // changeMode(5);   // changing mode does not seem to matter at all, so we can just ignore for now
     runAllIterations();
-    calcStatistics();
+
+    if(g_eTimebase == TIMEBASE_S1990)
+        calcStatisticsS1990();
+    else
+        calcStatistics();
+
+    calcLongStatistics();
+
+#if USE_LINE_INT_TIMEBASE==1
+    calcLineStatistics();
+#endif
     // changeMode(0);
 
 #if DEBUG_FORCE_TURBO_IF_AVAILABLE==1
@@ -1157,6 +4669,64 @@ enableTurboIfAvailable(true);
 #endif
 
     printReport();
+
+#if SELF_CALIBRATION==1
+    printSelfCalibration();
+#endif
+
+#if VERNIER==1
+    printVernier();
+#endif
+
+#if JITTER==1
+    printJitter();
+#endif
+
+#if CLOCK_CHECK==1
+    printClockCheck();
+#endif
+
+#if USE_LINE_INT_TIMEBASE==1
+    printLineReport();
+#endif
+
+#if LINE_PROFILE==1
+    printLineProfile();
+#endif
+
+#if OPCODE_SWEEP==1
+    printSweepReport();
+#endif
+
+#if PORT_SWEEP==1
+    printPortSweep();
+#endif
+
+#if BLOCK_BENCH==1
+    printBlockBench();
+#endif
+
+#if MEMORY_ATLAS==1
+    printMemoryAtlas();
+#endif
+
+#if VRAM_MATRIX==1
+    printVRAMMatrix();
+#endif
+
+#if VDP_CMD_BENCH==1
+    printVDPCommandBench();
+#endif
+
+#if CMD_CONTENTION==1
+    printCommandContention();
+#endif
+
+#if V9958_WTE==1
+    printWaitMode();
+#endif
+
+    signalDone();
     // print("testline1\r\n");
     // print("testline2");
 
@@ -1164,8 +4734,10 @@ enableTurboIfAvailable(true);
 spin_forever: goto spin_forever;
 #endif
 
+#if DEBUG_FORCE_R800_FULLSPEED_IF_AVAILABLE==1
     if(sOrgCPU != -1)
         changeCPU(sOrgCPU);
+#endif
 
     return 0;
 }
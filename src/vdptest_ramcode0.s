@@ -5,6 +5,7 @@
 ; ----------------------------------------------------------------------------
 ; CONSTANTS
     VDPPORT1	.equ 0x99
+    RG0SAV      .equ 0xF3DF             ; BIOS mirror of VDP R#0
 
 ; ----------------------------------------------------------------------------
 ; EXTERNAL REFERENCES
@@ -13,6 +14,13 @@
     .globl      _g_pFncCurStartupBlock
     .globl      _runTestAsmInMem
     .globl      _g_uExtraRounds
+    .globl      _g_uLineIntNext
+    .globl      _g_uLineIntStep
+    .globl      _g_uLineSample
+    .globl      _g_uLineSamples
+    .globl      _g_anLinePC
+    .globl      _g_auLineXtra
+    .globl      _g_uLongFramesLeft
 
 _UPPERCODE_BEGIN::
 
@@ -57,11 +65,12 @@ commonTestRetSpot::
 ; the PC reg and ALSO change the stack so that running program jumps to the end
 ; of the test (=ret). This latter part only to save time during tests.
 ; 
-; Cost: 171 (on first, when g_bStorePCReg==true)
+; Cost: 171 when g_bStorePCReg==false (all frames but the last), 46 on R800
 ; + CPU kicking this off should be: +13+1 (13 according to this:
 ; http://www.z80.info/interrup.htm) and as MSX always has +1 cycle per M1, we
 ; add 1 cycle. Furthermore there is "JP _customISR" at 0x0038 (=11 cycles)
-; Totals: 196 cycles
+; Totals: 196 cycles. With USE_IM2: 19+1 for the kick-off, and the JP is in
+; the IM 2 stub (see initIM2). Totals: 202 cycles
 ; MODIFIES: (No registers of course!)
 _customISR::
     push	af
@@ -112,4 +121,133 @@ leave_isr:
     ei
     ret
 
+; ----------------------------------------------------------------------------
+; Long test variant of _customISR. Counts down g_uLongFramesLeft, and only
+; when it reaches zero, _customISR takes over (storing PC-reg etc). All the
+; other VBLANKs are just reset. The cost of this one cancels out, as the long
+; tests are compared to each other and not to a single frame.
+; MODIFIES: (No registers of course!)
+_customLongISR::
+    push	af
+
+    ld      a, (_g_uLongFramesLeft)
+    dec     a
+    ld      (_g_uLongFramesLeft), a
+    jr      z, long_isr_last
+
+    xor 	a                       ; get status for sreg 0
+    out		(VDPPORT1), a
+    ld		a, #0x8F
+    out		(VDPPORT1), a
+    nop
+    in		a, (VDPPORT1)			; read VDP S#0 to reset VBLANK IRQ
+
+    pop		af
+    ei
+    ret
+
+long_isr_last:
+    pop		af
+    jp      _customISR              ; stack is as on entry
+
+; ----------------------------------------------------------------------------
+; Line interrupt variant of _customISR. Resets the FH flag (S#1) and moves the
+; line interrupt (R#19) g_uLineIntStep lines further down. When g_bStorePCReg
+; is true the PC-reg and g_uExtraRounds are stored as sample g_uLineSample.
+; After g_uLineSamples samples, the program is forced to commonTestRetSpot
+; the same way as in _customISR, and the line interrupt (IE1) is turned off,
+; so it does not go on every g_uLineIntStep lines. startLineIteration turns
+; it on again.
+; The VBLANK interrupt (IE0) is expected to be off while this one is in use.
+;
+; Cost: 568 (on every sample but the last, g_bStorePCReg==true)
+; + 25 for kicking off, as in _customISR.
+; Totals: 593 cycles (FRAME_CYCLES_LINE_INT)
+; MODIFIES: (No registers of course!)
+_customLineISR::
+    push	af
+    push    bc
+    push    de
+    push	hl
+
+    ld      a, #1                   ; get status for sreg 1
+    out		(VDPPORT1), a
+    ld		a, #0x8F
+    out		(VDPPORT1), a
+    nop
+    in		a, (VDPPORT1)			; read VDP S#1 to reset FH
+
+    xor 	a                       ; back to sreg 0, as BIOS expects
+    out		(VDPPORT1), a
+    ld		a, #0x8F
+    out		(VDPPORT1), a
+
+    ld      a, (_g_uLineIntStep)    ; move on to the next line
+    ld      b, a
+    ld      a, (_g_uLineIntNext)
+    add     a, b
+    ld      (_g_uLineIntNext), a
+    out		(VDPPORT1), a
+    ld		a, #19|0x80             ; R#19, line interrupt
+    out		(VDPPORT1), a
+
+    ld      a, (_g_bStorePCReg)     ; global switch on storing or not
+    or      a
+    jr      z, leave_line_isr
+
+    ; -- BEGIN STORING PART --
+	ld		hl, #4*2				; the main program PC should be found on the stack
+	add		hl, sp
+	ld		e, (hl)
+	inc		hl
+	ld		d, (hl)                 ; DE: PC-reg
+
+    ld      a, (_g_uLineSample)
+    ld      c, a
+    ld      b, #0
+
+    push    hl
+    ld      hl, #_g_anLinePC
+    add     hl, bc
+    add     hl, bc
+    ld      (hl), e
+    inc     hl
+    ld      (hl), d
+
+    ld      hl, #_g_auLineXtra
+    add     hl, bc
+    ld      a, (_g_uExtraRounds)
+    ld      (hl), a
+    pop     hl
+
+    inc     c
+    ld      a, c
+    ld      (_g_uLineSample), a
+    ld      a, (_g_uLineSamples)
+    cp      c
+    jr      nz, leave_line_isr
+
+    ld      bc, #commonTestRetSpot  ; all samples taken, force return-to address
+    ld      (hl), b
+    dec     hl
+    ld      (hl), c
+
+    ld      a, (RG0SAV)             ; IE1 off, no more line interrupts
+    out		(VDPPORT1), a
+    ld		a, #0|0x80              ; R#0
+    out		(VDPPORT1), a
+
+    xor     a
+    ld      (_g_bStorePCReg), a
+    ; -- END STORING PART --
+
+leave_line_isr:
+
+    pop 	hl
+    pop     de
+    pop     bc
+    pop		af
+    ei
+    ret
+
 _UPPERCODE_END::
\ No newline at end of file
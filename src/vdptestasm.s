@@ -42,6 +42,29 @@
     VDPPALETTE      .equ 0x9A
     VDPSTREAM       .equ 0x9B
 
+    RG1SAV          .equ 0xF3E0             ; mirror of VDP R#1
+    IE0_BITMASK     .equ #0b00100000        ; to be used with RG1SAV, VBLANK interrupt enable
+
+    S1990_TIMER_L   .equ 0xE6               ; turbo R system timer. Write: reset. Read: low byte
+    S1990_TIMER_H   .equ 0xE7               ; turbo R system timer. Read: high byte. 3.911us per tick
+
+; ----------------------------------------------------------------------------
+; EXTERNAL REFERENCES
+    .globl      _g_pFncCurStartupBlock
+    .globl      call_hl
+    .globl      _commonStartForAllTests
+    .globl      _runTestAsmInMem
+    .globl      _g_bStorePCReg
+    .globl      _g_uExtraRounds
+    .globl      commonTestRetSpot
+    .globl      _g_pJitterNext
+    .globl      _g_pJitterEnd
+    .globl      _g_nClockFrames
+    .globl      _g_lClockVBLFirst
+    .globl      _g_lClockVBLLast
+    .globl      _g_lClockIter
+    .globl      _g_auAtlasSwitch
+
 ;-------------------------
 ; Uses the RTC clock: https://www.msx.org/wiki/Real_Time_Clock_Programming
 ;
@@ -74,94 +97,102 @@ _readClock::
 	and		#0x0F
     ret
 
-; Cost: 60+73 = 133 cycles
-; trashes AF, AF'
-.macro recordTime regid addr
-    ld      a,#regid
-    call    _setupClockForDigitRead
-	in		a,(RTC_PORT_DATA)
-	and		#0x0F
-    ld      (addr),a
+; ----------------------------------------------------------------------------
+; Read the S1990 timer into DE. High is read before and after the low byte, if
+; it moved, low has just wrapped and is read again.
+; MODIFIES: AF, DE
+.macro readTimerS1990 ?again
+again:
+    in      a,(S1990_TIMER_H)
+    ld      d,a
+    in      a,(S1990_TIMER_L)
+    ld      e,a
+    in      a,(S1990_TIMER_H)
+    cp      d
+    jr      nz,again
 .endm
 
 ; ----------------------------------------------------------------------------
-; This one runs fully in DI.
-; ASSUMES:
-;           that the test code is present at _runTestAsmInMem (normally 0x8000)
-; MODIFIES: 
-;
-; void longTest(void);
-_longTest::
-
-    di
-
-    ; set up for changing background color every time we send a byte to 0x9B port
-    ld      a,#7|0x80               ; "R#7 border colour", but plan for NON-autoincrement
+; Turn the VBLANK interrupt (IE0) off or back on, by writing R#1. When off, the
+; "ei" in macroTEST_TAIL can not give us an interrupt in the middle of a timing.
+; MODIFIES: AF
+.macro setVBlankIntNI enable
+    ld      a,(RG1SAV)
+.ifeq enable
+    and     #~IE0_BITMASK
+.endif
     out     (VDPPORT1),a
-    ld      a,#17|0x80              ; reg write in "R#17 | indirect specification of R#n"
+    ld      a,#1|0x80
     out     (VDPPORT1),a
+.endm
 
-    ; set up for reading, in case we test reads
-    ld      a,#1                    ; get status for S#1
-    out		(VDPPORT1), a			; status register number
-    ld		a,#0x8F				    ; VDP register R#15
-    out		(VDPPORT1), a			; out VDP register number
-
-    ld      de,#438                 ; total iterations of ROM-block (to be used far down)
-    ld      c,#0x0F                 ; just a quick mask, as these are 4 bit only
+; ----------------------------------------------------------------------------
+; Alternative timebase for turbo R: brackets a run through the unrolled test
+; block with reads of the S1990 system timer. The startup block of the
+; current test (g_pFncCurStartupBlock) is run first. The run starts at pEntry
+; and ends when macroTEST_TAIL does "jp (ix)". The fixed cost around the block
+; is the same for every entry point, so the caller should use the difference
+; of two runs of different lengths.
+; ASSUMES:
+;           that the test code is present at _runTestAsmInMem
+; IN:       HL: entry point, somewhere in the unrolled block
+; OUT:      DE: timer ticks (3.911us each)
+; MODIFIES: AF, BC, DE, HL, AF', BC', DE', HL' (and whatever the test does)
+;
+; u16 runTimedS1990(u8* pEntry);
+_runTimedS1990::
+    push    ix
 
-    ; SYNCRONIZING with the RTC - we kick off RIGHT after the digit flipped
-    ld      a,#0                    ; lower digit of the seconds (values 0-9)
-    call    _setupClockForDigitRead
+    di
+    setVBlankIntNI 0
 
-	in		a,(RTC_PORT_DATA)
-	and		c
+    ld      ix,#timed_s1990_stop    ; tail of the unrolled block ends up here
+    exx
+    ld      hl,#timed_s1990_dummy   ; tail does "inc (hl')", keep it away from g_uExtraRounds
+    exx
 
-    add     a,#2                    ; inc by two seconds, to avoid a tick while doing these preps
-    cp      #0x0A
-    jr      c,weiter
-    sub     #0x0A
+    push    hl                      ; entry point, consumed by the "ret" below
+    ld      hl,(_g_pFncCurStartupBlock)
+    call    call_hl                 ; registers for the test are set here, don't touch them from now
 
-weiter:
-    ld      b, a
+    out     (S1990_TIMER_L),a       ; reset timer. TIMING STARTS HERE
+    ret                             ; "jp" to entry point
 
-spin_0:                             ; spin until the right value occurs
-	in		a, (RTC_PORT_DATA)
-	and		c
-    cp      b
-    jp      nz,spin_0               ; this will loop forever when the clock is not working
-    ; TIMING STARTS HERE (cycle counting)
+timed_s1990_stop:
+    readTimerS1990                  ; TIMING ENDS HERE
 
-    ld      (_g_uSecondsL0),a
-    
-    recordTime 1 _g_uSecondsH0      ; 133 cycles
-    recordTime 2 _g_uMinsL0         ; 133 cycles
-    recordTime 3 _g_uMinsH0         ; 133 cycles
+    setVBlankIntNI 1
+    ei
 
-    call    _runTestAsmInMem
+    pop     ix
+    ret
 
-    ; grab timestamp
-encore_une_fois:
-    recordTime 0 _g_uSecondsL1
+; ----------------------------------------------------------------------------
+; Measure uFrames whole frames with the S1990 system timer. Starts at a VBLANK
+; interrupt (halt), so the ISR cost is the same on both ends.
+; IN:       A: number of frames (>0)
+; OUT:      DE: timer ticks (3.911us each)
+; MODIFIES: AF, B, DE
+;
+; u16 measureFramesS1990(u8 uFrames);
+_measureFramesS1990::
     ld      b,a
-    recordTime 1 _g_uSecondsH1
-    recordTime 2 _g_uMinsL1
-    recordTime 3 _g_uMinsH1
-
-    ld      a,#0                    ; check if the second counter moved while we grabbed the timestamp. Re-fetch if so
-    call    _setupClockForDigitRead
-	in		a,(RTC_PORT_DATA)
-	and		#0x0F
-    cp      b
-    jp      nz, encore_une_fois
+    ei
+    halt
+    out     (S1990_TIMER_L),a       ; reset timer. TIMING STARTS HERE
 
-    ; fix colors
-    ld      a,#0xF4
-    out     (VDPSTREAM),a
+frames_s1990_loop:
+    halt
+    djnz    frames_s1990_loop
 
-    ei
+    readTimerS1990                  ; TIMING ENDS HERE
     ret
 
+    .area _DATA
+timed_s1990_dummy:
+    .ds     1
+    .area _CODE
+
 ; ----------------------------------------------------------------------------
 ; MODIFIES: AF
 ;
@@ -195,6 +226,449 @@ _setPALRefreshRate::
     ei
     ret
 
+; ----------------------------------------------------------------------------
+; Write uLen bytes to VRAM, at the address already set up (setVRAMAddressNI)
+; IN:       A:  uLen (1-255)
+;           DE: pSrc
+; MODIFIES: BC, DE, HL
+; void writeVRAMNI(u8 uLen, u8* pSrc);
+_writeVRAMNI::
+    ld      b, a
+    ex      de, hl
+    ld      c, #VDPIO
+    otir
+    ret
+
+; ----------------------------------------------------------------------------
+; Read uLen bytes from VRAM, at the address already set up (setVRAMAddressNI)
+; IN:       A:  uLen (1-255)
+;           DE: pDst
+; MODIFIES: BC, DE, HL
+; void readVRAMNI(u8 uLen, u8* pDst);
+_readVRAMNI::
+    ld      b, a
+    ex      de, hl
+    ld      c, #VDPIO
+    inir
+    ret
+
+; ----------------------------------------------------------------------------
+; Repeat the first uSize bytes at _runTestAsmInMem until nBytes are filled.
+; Uses a forward, overlapping ldir, which copies the pattern along. Much
+; faster than a memcpy per instruction, which matters when there are
+; thousands of tests to set up.
+; IN:       A:  uSize (size of unroll pattern)
+;           DE: nBytes, including the first pattern. Must be > uSize
+; MODIFIES: AF, BC, DE, HL
+; void replicateUnroll(u8 uSize, u16 nBytes);
+_replicateUnroll::
+    ld      c, a
+    ld      b, #0                   ; BC: uSize
+    ex      de, hl                  ; HL: nBytes
+    or      a
+    sbc     hl, bc
+    push    hl                      ; bytes left to fill
+
+    ld      hl, #_runTestAsmInMem
+    ld      d, h
+    ld      e, l
+    add     hl, bc
+    ex      de, hl                  ; HL: source, DE: source + uSize
+
+    pop     bc
+    ldir
+    ret
+
+; ----------------------------------------------------------------------------
+; As _commonStartForAllTests, but IY is preserved for C. For tests which
+; modify IY, like the opcode sweep (FD-prefixed instructions)
+; MODIFIES: (like _commonStartForAllTests)
+; void commonStartKeepIY(void);
+_commonStartKeepIY::
+    push    iy
+    call    _commonStartForAllTests
+    pop     iy
+    ret
+
+; ----------------------------------------------------------------------------
+; VBLANK ISR for the jitter run. Every frame the PC-reg and g_uExtraRounds
+; are stored at g_pJitterNext (3 bytes), while the unrolled block runs on.
+; When g_pJitterNext reaches g_pJitterEnd, the program is forced to
+; commonTestRetSpot. The cost is the same in every frame and cancels out
+; between the samples, so this one does not need to be in _UPPER.
+; MODIFIES: (No registers of course!)
+_customJitterISR::
+    push	af
+    push    bc
+    push    de
+    push	hl
+
+    xor 	a                       ; get status for sreg 0
+    out		(VDPPORT1), a
+    ld		a, #0x8F
+    out		(VDPPORT1), a
+    nop
+    in		a, (VDPPORT1)			; read VDP S#0 to reset VBLANK IRQ
+
+    ld      a, (_g_bStorePCReg)
+    or      a
+    jr      z, leave_jitter_isr
+
+	ld		hl, #4*2				; the main program PC should be found on the stack
+	add		hl, sp
+	ld		e, (hl)
+	inc		hl
+	ld		d, (hl)                 ; DE: PC-reg
+
+    push    hl
+    ld      hl, (_g_pJitterNext)
+    ld      (hl), e
+    inc     hl
+    ld      (hl), d
+    inc     hl
+    ld      a, (_g_uExtraRounds)
+    ld      (hl), a
+    inc     hl
+    ld      (_g_pJitterNext), hl
+    ld      bc, (_g_pJitterEnd)
+    or      a
+    sbc     hl, bc
+    pop     hl
+    jr      nz, leave_jitter_isr
+
+    ld      bc, #commonTestRetSpot  ; all samples taken, force return-to address
+    ld      (hl), b
+    dec     hl
+    ld      (hl), c
+
+    xor     a
+    ld      (_g_bStorePCReg), a
+
+leave_jitter_isr:
+
+    pop 	hl
+    pop     de
+    pop     bc
+    pop		af
+    ei
+    ret
+
+; ----------------------------------------------------------------------------
+; Clock check ISR. Counts the VBLANKs in g_nClockFrames, and stores the loop
+; count of _runClockWindow (C:DE) at the first and the last one.
+; Cost: 221 (not on the first), + the kick-off as for _customISR
+; MODIFIES: (No registers of course!)
+_customClockISR::
+    push	af
+    push	hl
+
+    xor 	a                       ; get status for sreg 0
+    out		(VDPPORT1), a
+    ld		a, #0x8F
+    out		(VDPPORT1), a
+    nop
+    in		a, (VDPPORT1)			; read VDP S#0 to reset VBLANK IRQ
+
+    ld      (_g_lClockVBLLast), de
+    ld      a, c
+    ld      (_g_lClockVBLLast+2), a
+
+    ld      hl, (_g_nClockFrames)
+    ld      a, h
+    or      l
+    jr      nz, clock_isr_count
+
+    ld      (_g_lClockVBLFirst), de
+    ld      a, c
+    ld      (_g_lClockVBLFirst+2), a
+
+clock_isr_count:
+    inc     hl
+    ld      (_g_nClockFrames), hl
+
+    pop		hl
+    pop		af
+    ei
+    ret
+
+; ----------------------------------------------------------------------------
+; Clock check. Counts the rounds of a loop of known cost from one change of
+; the RTC seconds digit, and uSeconds seconds on. _customClockISR must be
+; active, the VBLANKs are counted from the first change.
+; Cost per round: 61 (Z80). Every 65536 rounds +16, and on every change of
+; the digit but the last +28. Runs from ROM in the ROM version, as the other
+; code here.
+; IN:       A: uSeconds (>0)
+; OUT:      g_lClockIter (rounds, 24 bits). Interrupts are disabled
+; MODIFIES: AF, BC, DE, HL
+; void runClockWindow(u8 uSeconds);
+_runClockWindow::
+    ld      h, a                    ; H: seconds left
+    xor     a                       ; register 0: seconds, low digit
+    call    _setupClockForDigitRead
+    in      a, (RTC_PORT_DATA)
+    and     #0x0F
+    ld      b, a
+
+clock_sync:
+    in      a, (RTC_PORT_DATA)
+    and     #0x0F
+    cp      b
+    jr      z, clock_sync
+    ld      b, a                    ; B: the digit
+
+    di
+    xor     a
+    ld      c, a                    ; C:DE rounds
+    ld      d, a
+    ld      e, a
+    ld      (_g_nClockFrames), de
+    ei
+
+clock_loop:
+    in      a, (RTC_PORT_DATA)      ; 12
+    and     #0x0F                   ; 8
+    cp      b                       ; 5
+    jr      nz, clock_edge          ; 8
+clock_count:
+    inc     de                      ; 7
+    ld      a, d                    ; 5
+    or      e                       ; 5
+    jp      nz, clock_loop          ; 11
+    inc     c
+    jp      clock_loop
+
+clock_edge:
+    ld      b, a
+    dec     h
+    jr      nz, clock_count
+
+    di                              ; no more VBLANKs counted
+    ld      (_g_lClockIter), de
+    ld      a, c
+    ld      (_g_lClockIter+2), a
+    ret
+
+; ----------------------------------------------------------------------------
+; Memory atlas, reads in page 0 and 1. Switches the page to another slot,
+; runs _commonStartForAllTests and switches it back. The secondary slot
+; register is in page 3 of the primary slot, so this is copied to page 2 RAM
+; (ATLAS_PAGE_RUN) and run there, relative jumps only. No stack while page 3
+; is switched. Page 0 only with IM 2.
+; IN:       g_auAtlasSwitch: primary slot and mask in the bits of the page,
+;           secondary slot in the bits of the page, and the primary slot in
+;           the bits of page 3 (0xFF: not expanded)
+; MODIFIES: AF, BC, DE, HL (and as _commonStartForAllTests)
+; void atlasPageRun(void);
+_atlasPageRun::
+    di
+    ld      hl, (_g_auAtlasSwitch)  ; L: primary, H: mask
+    ld      bc, (_g_auAtlasSwitch+2); C: secondary, B: primary in page 3
+    in      a, (0xA8)
+    ld      d, a                    ; D: the primary slots as they were
+    ld      a, h
+    cpl
+    and     d
+    or      l
+    ld      l, a                    ; L: the primary slots to run with
+
+    ld      a, b
+    inc     a
+    jr      z, atlas_page_prim      ; not expanded
+
+    ld      a, d
+    and     #0b00111111
+    or      b
+    out     (0xA8), a               ; page 3 to the primary slot, for its 0xFFFF
+    ld      a, (#0xFFFF)
+    cpl
+    ld      e, a                    ; E: its secondary slots as they were
+    ld      a, h
+    cpl
+    and     e
+    or      c
+    ld      (#0xFFFF), a
+
+atlas_page_prim:
+    ld      a, l
+    out     (0xA8), a               ; page 3 is back
+    push    de
+    push    bc
+    ei
+    call    _commonStartForAllTests
+    di
+    pop     bc
+    pop     de
+
+    ld      a, b
+    inc     a
+    jr      z, atlas_page_restore
+
+    ld      a, d
+    and     #0b00111111
+    or      b
+    out     (0xA8), a
+    ld      a, e
+    ld      (#0xFFFF), a
+
+atlas_page_restore:
+    ld      a, d
+    out     (0xA8), a
+    ei
+    ret
+_atlasPageRunEnd::
+
+; ----------------------------------------------------------------------------
+; Command engine benchmark. Frames are counted on the rising edge of VR in
+; S#2, the same register as CE. The command in pCmd (R#32-R#46) is issued
+; again as soon as the previous one is done, until uFrames frames have
+; passed. The last command is not counted, but waited for.
+; Interrupts must be off, S#0 is selected when done.
+; IN:       A:  uFrames (>0)
+;           DE: pCmd, 15 bytes for R#32-R#46
+; OUT:      DE: completed commands
+; MODIFIES: AF, BC, DE, HL
+; u16 runVDPCommandNI(u8 uFrames, u8* pCmd);
+_runVDPCommandNI::
+    ld      (vdp_cmd_src), de
+    ld      l, a
+    ld      de, #0
+
+    ld      a, #2                   ; S#2
+    out     (VDPPORT1), a
+    ld      a, #15|0x80
+    out     (VDPPORT1), a
+
+vdp_cmd_sync:
+    in      a, (VDPPORT1)
+    and     #0x40                   ; VR
+    jr      nz, vdp_cmd_sync
+vdp_cmd_sync_vr:
+    in      a, (VDPPORT1)
+    and     #0x40
+    jr      z, vdp_cmd_sync_vr
+    ld      h, a                    ; H: last VR
+
+vdp_cmd_issue:
+    ld      a, #32                  ; R#17: indirect from R#32, auto increment
+    out     (VDPPORT1), a
+    ld      a, #17|0x80
+    out     (VDPPORT1), a
+
+    push    hl
+    ld      hl, (vdp_cmd_src)
+    ld      bc, #(15 << 8) | VDPSTREAM
+    otir
+    pop     hl
+
+vdp_cmd_poll:
+    in      a, (VDPPORT1)
+    ld      b, a
+    and     #0x40
+    cp      h
+    jr      z, vdp_cmd_ce
+    ld      h, a
+    or      a
+    jr      z, vdp_cmd_ce           ; end of VR
+    dec     l
+    jr      z, vdp_cmd_done
+vdp_cmd_ce:
+    ld      a, b
+    rra                             ; CE
+    jr      c, vdp_cmd_poll
+    inc     de
+    jr      vdp_cmd_issue
+
+vdp_cmd_done:
+    in      a, (VDPPORT1)
+    rra
+    jr      c, vdp_cmd_done
+
+    xor     a                       ; S#0, as the BIOS expects
+    out     (VDPPORT1), a
+    ld      a, #15|0x80
+    out     (VDPPORT1), a
+    ret
+
+    .area _DATA
+vdp_cmd_src:
+    .ds     2
+    .area _CODE
+
+; ----------------------------------------------------------------------------
+; VDP ID from S#1 (bit 1-5): 0 = V9938, 2 = V9958
+; MODIFIES: AF
+; u8 getVDPID(void);
+_getVDPID::
+    di
+    ld      a, #1                   ; S#1
+    out     (VDPPORT1), a
+    ld      a, #15|0x80
+    out     (VDPPORT1), a
+    nop
+    in      a, (VDPPORT1)
+    push    af
+
+    xor     a                       ; back to S#0, as the BIOS expects
+    out     (VDPPORT1), a
+    ld      a, #15|0x80
+    out     (VDPPORT1), a
+    ei
+
+    pop     af
+    rrca
+    and     #0x1F
+    ret
+
+; ----------------------------------------------------------------------------
+; Start a command engine command, the running one (if any) is stopped first
+; IN:       HL: pCmd, 15 bytes for R#32-R#46
+; MODIFIES: AF, BC, HL
+; void startVDPCommandNI(u8* pCmd);
+_startVDPCommandNI::
+    xor     a                       ; STOP
+    out     (VDPPORT1), a
+    ld      a, #46|0x80
+    out     (VDPPORT1), a
+
+    ld      a, #32                  ; R#17: indirect from R#32, auto increment
+    out     (VDPPORT1), a
+    ld      a, #17|0x80
+    out     (VDPPORT1), a
+
+    ld      bc, #(15 << 8) | VDPSTREAM
+    otir
+    ret
+
+; ----------------------------------------------------------------------------
+; Interrupt mode. IM 1 is the BIOS (JP at 0x0038), IM 2 is the vector table
+; at I*256 (see initIM2)
+; IN:       A:  0 for IM 1, else I for IM 2
+; MODIFIES: -
+; void setInterruptModeNI(u8 uTable);
+_setInterruptModeNI::
+    or      a
+    jr      z, set_im1
+    ld      i, a
+    im      2
+    ret
+set_im1:
+    im      1
+    ret
+
+; ----------------------------------------------------------------------------
+; Write a VDP register. Mirrors (RG0SAV++) are NOT updated
+; IN:       A:  value
+;           L:  register number
+; MODIFIES: AF
+; void writeVDPRegNI(u8 uValue, u8 uReg);
+_writeVDPRegNI::
+	out 	(VDPPORT1), a
+	ld  	a, l
+	or      #0x80
+	out 	(VDPPORT1), a
+    ret
+
 ; ----------------------------------------------------------------------------
 ; Enable VDP port #98 for start writing at address (A&3)DE 
 ; IN:       A:  Bits: 0W0000UU, W = Write, U means Upper VRAM address(bit 17-18)
@@ -231,12 +705,12 @@ _setVRAMAddressNI::
 
 ; ----------------------------------------------------------------------------
 ; Print to console. Both '\r\n' is needed for a carriage return and newline.
-; Heavy(!), as it does interslot calls per character (but print performance is
-; of no concern in this program)
+; Heavy(!), as it does interslot calls per character. print() in vdptest.c
+; writes SCREEN 0 directly to VRAM, and only falls back on this one
 ; IN:       HL - pointer to zero-terminated string
 ; MODIFIES: ? (BIOS...)
-; void print(u8* szMessage)
-_print::
+; void printBIOS(u8* szMessage)
+_printBIOS::
 
     ; ; BDOS Variant (needs $ as ending character)
     ; ex      de, hl                  ; p to msg in de
@@ -468,6 +942,16 @@ CALSUB:
     ret
 
 
+; ----------------------------------------------------------------------------
+; Write all 16 palette entries, the palette pointer (R#16) must be set up
+; IN:       HL: pSrc, 32 bytes
+; MODIFIES: BC, HL
+; void writePaletteNI(u8* pSrc);
+_writePaletteNI::
+    ld      bc, #(32 << 8) | VDPPALETTE
+    otir
+    ret
+
 ; ----------------------------------------------------------------------------
 ; Init/Stores palette in VRAM
 ; IN:       -